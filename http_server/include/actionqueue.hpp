@@ -0,0 +1,116 @@
+#pragma once
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "headers.hpp"
+#include "dict.hpp"
+#include "grid.hpp"
+#include "ref.hpp"
+#include <boost/ptr_container/ptr_map.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/uuid/uuid_generators.hpp>
+#include <Poco/Condition.h>
+#include <Poco/Mutex.h>
+#include <Poco/Runnable.h>
+#include <Poco/Thread.h>
+#include <deque>
+#include <stdint.h>
+
+namespace haystack
+{
+    class Server;
+
+    /**
+    ActionQueue is the executor of invokeAction.
+
+    Actions are queued as jobs and run by a fixed set of worker threads,
+    which look up the target record and call Server::on_invoke_action, so
+    a slow action does not hold the HTTP thread that requested it. At most
+    capacity jobs wait to run, further submits fail. The outcome of the
+    last retain finished jobs is kept for jobStatus.
+    */
+    class ActionQueue : public Poco::Runnable, boost::noncopyable
+    {
+    public:
+        enum Status { PENDING, RUNNING, DONE, FAILED };
+
+        ActionQueue(Server& server, size_t capacity = 256, size_t threads = 4, size_t retain = 1024);
+        ~ActionQueue();
+
+        /**
+        Finish the running jobs and join the workers. Jobs still queued
+        fail and further submits throw runtime_error.
+        */
+        void stop();
+
+        /**
+        Queue the action and return the job id, a random uuid which
+        other clients cannot guess.
+        Throw runtime_error if the queue is full.
+        */
+        std::string submit(const Ref& id, const std::string& action, const Dict& args);
+
+        /**
+        Wait up to timeout millis, or forever if negative, for the job to
+        finish. Return the status seen when the wait ended and set result
+        if the job is DONE, the result is NULL if the action returned
+        none. Throw runtime_error if the job is unknown or the action
+        failed.
+        */
+        Status wait(const std::string& job, long timeout, Grid::auto_ptr_t& result) const;
+
+        /**
+        Current status of the job, throw runtime_error if it is unknown
+        */
+        Status status(const std::string& job) const;
+
+        /**
+        Number of jobs waiting to run
+        */
+        size_t pending() const;
+
+        static const std::string status_name(Status status);
+
+        void run();
+
+    private:
+        struct Job
+        {
+            Job(const std::string& n, const Ref& i, const std::string& a, const Dict& r)
+                : name(n), id(i.value), action(a), args(new Dict), status(PENDING) { args->add(r); }
+            const std::string name;
+            const std::string id;
+            const std::string action;
+            Dict::auto_ptr_t args;
+            Status status;
+            boost::shared_ptr<const Grid> result;
+            std::string error;
+        };
+
+        typedef boost::ptr_map<std::string, Job> jobs_t;
+
+        // lookup a job with m_mutex held
+        const Job& find(const std::string& job) const;
+
+        Server& m_server;
+        const size_t m_capacity;
+        const size_t m_threads;
+        const size_t m_retain;
+
+        mutable Poco::Mutex m_mutex;
+        Poco::Condition m_ready;
+        mutable Poco::Condition m_done;
+        jobs_t m_jobs;
+        std::deque<Job*> m_queue;
+        // finished jobs, oldest first
+        std::deque<std::string> m_finished;
+        boost::uuids::random_generator m_ids;
+        bool m_stop;
+        boost::ptr_vector<Poco::Thread> m_workers;
+    };
+};
@@ -0,0 +1,102 @@
+#pragma once
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "headers.hpp"
+#include <Poco/Condition.h>
+#include <Poco/Mutex.h>
+#include <map>
+
+namespace haystack
+{
+    /**
+    Admission bounds the requests running at once.
+
+    Each op belongs to a priority class with its own concurrency limit
+    and queue time budget, and may have a limit of its own. A request
+    waits at most the queue time of its class for a free slot and is
+    rejected otherwise, so a burst of bulk requests cannot hold every
+    worker while latency critical ops wait behind them. A waiting request
+    holds its worker too, so the requests running or waiting in a class
+    stay below the number of workers and the rest are rejected at once.
+    */
+    class Admission : boost::noncopyable
+    {
+    public:
+        enum Priority { HIGH, NORMAL, LOW, PRIORITIES };
+
+        Admission();
+
+        /**
+        Limit the class to max requests at once, 0 for no limit, waiting
+        at most queue_time millis for a slot.
+        */
+        void limit(Priority p, size_t max, long queue_time);
+
+        /**
+        Number of workers serving requests, 0 if unknown. Running and
+        waiting requests of a class are kept below it.
+        */
+        void workers(size_t n);
+
+        /**
+        Limit the op to max requests at once, 0 for no limit
+        */
+        void limit(const std::string& op, size_t max);
+
+        /**
+        Wait for a slot of op in class p, false if none was free within
+        the queue time of the class. An admitted request must leave.
+        */
+        bool enter(const std::string& op, Priority p);
+        void leave(const std::string& op, Priority p);
+
+        /**
+        Number of requests rejected so far
+        */
+        size_t rejected() const;
+
+        /**
+        Holds a slot for the scope if admitted
+        */
+        class Scope : boost::noncopyable
+        {
+        public:
+            Scope(Admission& a, const std::string& op, Priority p)
+                : m_admission(a), m_op(op), m_priority(p), m_admitted(a.enter(op, p)) {}
+            ~Scope() { if (m_admitted) m_admission.leave(m_op, m_priority); }
+            bool admitted() const { return m_admitted; }
+        private:
+            Admission& m_admission;
+            const std::string m_op;
+            const Priority m_priority;
+            const bool m_admitted;
+        };
+
+    private:
+        struct Slots
+        {
+            Slots() : max(0), active(0), waiting(0) {}
+            size_t max;
+            size_t active;
+            size_t waiting;
+            bool free() const { return max == 0 || active < max; }
+        };
+
+        // a slot of the class and of the op is free
+        bool admits(const Slots& c, const std::string& op) const;
+
+        Slots m_classes[PRIORITIES];
+        long m_queue_time[PRIORITIES];
+        std::map<std::string, Slots> m_ops;
+        size_t m_workers;
+        size_t m_rejected;
+
+        mutable Poco::Mutex m_mutex;
+        Poco::Condition m_left;
+    };
+};
@@ -0,0 +1,51 @@
+#pragma once
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "headers.hpp"
+#include <Poco/Mutex.h>
+#include <istream>
+#include <vector>
+
+namespace haystack
+{
+    /**
+    BodyBuffer holds a request body read in large blocks.
+
+    Bodies are read straight into a buffer in blocks of CHUNK bytes, which
+    grows as the data arrives, and parsed from memory instead of one char
+    at a time from the socket stream. Buffers are taken from
+    a pool and returned to it, unless they grew too large to keep.
+    */
+    class BodyBuffer : boost::noncopyable
+    {
+    public:
+        enum { CHUNK = 64 * 1024 };
+
+        BodyBuffer();
+        ~BodyBuffer();
+
+        /**
+        Read the whole body of is, length is the Content-Length or
+        negative if unknown. Return false if the body is over max bytes.
+        */
+        bool read(std::istream& is, std::streamsize length, size_t max);
+
+        const char* data() const { return m_size > 0 ? &(*m_buf)[0] : ""; }
+        size_t size() const { return m_size; }
+
+    private:
+        // pooled buffers and the largest capacity kept in the pool
+        enum { MAX_POOLED = 32, MAX_POOLED_CAPACITY = 1024 * 1024 };
+
+        std::vector<char>* m_buf;
+        size_t m_size;
+
+        static Poco::FastMutex s_mutex;
+        static std::vector<std::vector<char>*> s_pool;
+    };
+};
@@ -0,0 +1,111 @@
+#pragma once
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "headers.hpp"
+#include "dict.hpp"
+#include "hischunk.hpp"
+#include <boost/ptr_container/ptr_map.hpp>
+#include <boost/shared_ptr.hpp>
+#include <Poco/Condition.h>
+#include <Poco/Mutex.h>
+#include <Poco/Runnable.h>
+#include <Poco/Thread.h>
+#include <vector>
+
+namespace haystack
+{
+    class Server;
+
+    /**
+    HisIngest is the storage queue of hisWrite.
+
+    Samples are queued in a buffer per point and a single worker thread
+    hands each buffer to Server::on_his_append, so concurrent writes to the
+    same point are coalesced into one append. Writers block until their
+    samples are stored. When more than capacity samples are queued writers
+    wait for the worker to drain the queue, and fail if it does not within
+    the timeout. A writer also fails if its samples are not stored within
+    the timeout, they are still stored later.
+    */
+    class HisIngest : public Poco::Runnable, boost::noncopyable
+    {
+    public:
+        HisIngest(Server& server, size_t capacity = 1024 * 1024, long timeout = 5000);
+        ~HisIngest();
+
+        /**
+        Store the samples queued and join the worker, further submits
+        throw runtime_error
+        */
+        void stop();
+
+        /**
+        Queue validated samples for the given historized record and wait
+        until they are stored. The samples vector is consumed.
+        Throw runtime_error if the queue stays full, the samples are not
+        stored within the timeout or the append fails.
+        */
+        void submit(const Dict& rec, std::vector<HisChunk::Sample>& samples);
+
+        /**
+        Queue the samples of several points at once, samples[i] belong to
+        recs[i], and wait until all of them are stored. The samples
+        vectors are consumed.
+        */
+        void submit(const std::vector<const Dict*>& recs, std::vector<std::vector<HisChunk::Sample> >& samples);
+
+        /**
+        Number of samples waiting to be stored
+        */
+        size_t pending() const;
+
+        /**
+        Number of point appends which failed so far, their writers get
+        the error
+        */
+        size_t failed() const;
+
+        void run();
+
+    private:
+        // completion slot of one writer, counts its batches not yet stored
+        struct Ticket
+        {
+            Ticket() : remaining(0) {}
+            size_t remaining;
+            std::string error;
+        };
+
+        // samples queued for one point
+        struct Batch
+        {
+            Batch(const Dict& r) : rec(new Dict), count(0) { rec->add(r); }
+            Dict::auto_ptr_t rec;
+            std::vector<HisChunk::Sample> samples;
+            size_t count;
+            std::vector<boost::shared_ptr<Ticket> > tickets;
+            std::string error;
+        };
+
+        typedef boost::ptr_map<std::string, Batch> queue_t;
+
+        Server& m_server;
+        const size_t m_capacity;
+        const long m_timeout;
+
+        mutable Poco::Mutex m_mutex;
+        Poco::Condition m_ready;
+        Poco::Condition m_stored;
+        queue_t m_queue;
+        size_t m_pending;
+        size_t m_failed;
+        bool m_running;
+        bool m_stop;
+        Poco::Thread m_thread;
+    };
+};
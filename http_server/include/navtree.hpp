@@ -0,0 +1,68 @@
+#pragma once
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "headers.hpp"
+#include "dict.hpp"
+#include "grid.hpp"
+#include <boost/shared_ptr.hpp>
+#include <Poco/Mutex.h>
+#include <map>
+#include <vector>
+
+namespace haystack
+{
+    /**
+    NavTree is the site, equip, point navigation index of a project.
+
+    Sites are the children of the root, equips the children of the site
+    of their siteRef and points the children of the equip of their
+    equipRef. The navId of a node is its record id. Records are added and
+    removed as they change, and the nav grid of a node is built once and
+    shared until one of its children changes.
+    */
+    class NavTree : boost::noncopyable
+    {
+    public:
+        NavTree() {}
+
+        /**
+        Index the record, it must outlive the tree or be removed first.
+        A record may be added before its parent.
+        */
+        void add(const Dict& rec);
+
+        /**
+        Remove the record, its children stay indexed under its id
+        */
+        void remove(const Dict& rec);
+
+        /**
+        Nav grid of the children of nav_id, "" for the root, with a navId
+        column. NULL if nav_id is not an indexed record.
+        */
+        boost::shared_ptr<const Grid> children(const std::string& nav_id) const;
+
+    private:
+        struct Node
+        {
+            Node() : rec(NULL) {}
+            const Dict* rec;
+            // sorted by id
+            std::vector<const Dict*> children;
+            boost::shared_ptr<const Grid> grid;
+        };
+
+        // navId of the parent of rec, false if rec is not part of the tree
+        static bool parent(const Dict& rec, std::string& nav_id);
+        static boost::shared_ptr<const Grid> children_grid(const Node& n);
+        typedef std::map<std::string, Node> nodes_t;
+
+        mutable Poco::FastMutex m_mutex;
+        mutable nodes_t m_nodes;
+    };
+};
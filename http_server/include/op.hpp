@@ -13,6 +13,9 @@
 #include "Poco/Net/HTTPServerResponse.h"
 #include "grid.hpp"
 #include "ref.hpp"
+#include "admission.hpp"
+#include "histogram.hpp"
+#include <stdint.h>
 
 using Poco::Net::HTTPServerRequest;
 using Poco::Net::HTTPServerResponse;
@@ -24,6 +27,25 @@ namespace haystack
     class Ref;
     class Val;
 
+    /**
+    Counters and phase latency histograms of an op, latencies in microseconds
+    */
+    struct OpMetrics
+    {
+        Counter requests;
+        Counter errors;
+        Counter cache_hits;
+        Counter rejected;
+        Counter bytes_in;
+        Counter bytes_out;
+        Counter rows;
+        // request parse, on_service, response encode and send, whole request
+        Histogram parse;
+        Histogram execute;
+        Histogram encode;
+        Histogram total;
+    };
+
     /**
     Op is the base class for server side operations exposed by the REST API.
     All methods on Op must be thread safe.
@@ -47,25 +69,65 @@ namespace haystack
         Service the request and return response.
         This method routes to "on_service(Server& db, const Grid& req)"
         */
-        void on_service(Server& db, HTTPServerRequest& req, HTTPServerResponse& res);
+        virtual void on_service(Server& db, HTTPServerRequest& req, HTTPServerResponse& res);
 
         /**
         Service the request and return response.
         */
         virtual Grid::auto_ptr_t on_service(Server& db, const Grid& req);
 
+        enum { NO_CACHE = 0, CACHE_FOREVER = -1 };
+
+        // largest request body read, bytes
+        enum { MAX_BODY = 256 * 1024 * 1024 };
+
+        // largest response body kept in the response cache, bytes
+        enum { MAX_CACHED_BODY = 1024 * 1024 };
+
+        /**
+        Millis an encoded response may be served from the response cache
+        of the server, NO_CACHE for ops which are not idempotent or
+        CACHE_FOREVER to keep it until the database version changes.
+        Responses over MAX_CACHED_BODY are streamed and not cached.
+        */
+        virtual long cache_ttl() const { return NO_CACHE; }
+
+        /**
+        Cache ttl of the response to req, ops answering some requests
+        with output which must not be cached override it.
+        */
+        virtual long cache_ttl(const Grid& req) const { return cache_ttl(); }
+
+        /**
+        Priority class of the op for admission control
+        */
+        virtual Admission::Priority priority() const { return Admission::NORMAL; }
+
+        /**
+        Metrics of the requests served by the op
+        */
+        const OpMetrics& metrics() const { return m_metrics; }
+
     protected:
+        // Write the response grid of req to os, false if it is an error grid
+        bool write_response(Server& db, const Grid& req, std::ostream& os);
+
         typedef boost::ptr_vector<Ref> refs_t;
         refs_t grid_to_ids(const Server& db, const Grid& grid) const;
 
         Val::auto_ptr_t val_to_id(const Server& db, const Val& val) const;
 
-    private:
+        // Millis of the meta timeout tag, in seconds or ms, capped at max.
+        // Return -1 if there is no timeout tag.
+        static long timeout_millis(const Dict& meta, long max);
+
         // Map the GET query parameters to grid with one row
         Grid::auto_ptr_t  get_to_grid(HTTPServerRequest& req);
 
         // Map the POST body to grid
         Grid::auto_ptr_t post_to_grid(HTTPServerRequest& req, HTTPServerResponse& res);
+
+        mutable OpMetrics m_metrics;
     };
 
     class StdOps
@@ -108,6 +170,10 @@ namespace haystack
         */
         static const Op& watch_list;
         /**
+        Stream watch changes as server-sent events.
+        */
+        static const Op& watch_stream;
+        /**
         Read/write writable point priority array.
         */
         static const Op& point_write;
@@ -123,10 +189,46 @@ namespace haystack
         Invoke action.
         */
         static const Op& invoke_action;
+        /**
+        Status and result of a queued action.
+        */
+        static const Op& job_status;
+        /**
+        Request counters and latency percentiles per op.
+        */
+        static const Op& metrics;
+        /**
+        Recent trace spans of the hot paths.
+        */
+        static const Op& trace;
+        /**
+        Recent filter reads slower than the threshold.
+        */
+        static const Op& slow_queries;
 
         typedef std::map<std::string, const Op* const> ops_map_t;
         static const ops_map_t& ops_map();
+
+        /**
+        Lookup an op by name with one hash and one compare in a perfect
+        hash table of ops_map. Return NULL if there is none.
+        */
+        static const Op* find(const char* name, size_t len);
+
     private:
+        struct Slot
+        {
+            Slot() : op(NULL) {}
+            std::string name;
+            const Op* op;
+        };
+
+        static uint32_t hash(const char* name, size_t len, uint32_t seed);
+        // build the perfect hash table of m_ops_map
+        static void build_table();
+
         static ops_map_t* m_ops_map;
+        static std::vector<Slot>* m_table;
+        static uint32_t m_seed;
     };
 }
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "headers.hpp"
+#include <Poco/Mutex.h>
+#include <Poco/Timestamp.h>
+#include <boost/shared_ptr.hpp>
+#include <list>
+#include <map>
+#include <stdint.h>
+
+namespace haystack
+{
+    /**
+    ResponseCache keeps the encoded responses of idempotent ops.
+
+    An entry is keyed by the op name and the zinc of its request grid and
+    is only valid for the database version it was encoded at, so a change
+    of the database drops every response computed before it. The least
+    recently used entries are evicted past max_bytes of keys and bodies.
+    */
+    class ResponseCache : boost::noncopyable
+    {
+    public:
+        /**
+        Encoded response, shared with the requests serving it
+        */
+        struct Entry
+        {
+            std::string body;
+            std::string etag;
+            // Content-Encoding of body, empty if not encoded
+            std::string encoding;
+        };
+        typedef boost::shared_ptr<const Entry> entry_ptr;
+
+        ResponseCache(size_t max_bytes = 16 * 1024 * 1024) : m_max_bytes(max_bytes), m_bytes(0) {}
+
+        /**
+        Lookup the response of key at version no older than ttl millis,
+        or any age if ttl is negative. NULL if there is none.
+        */
+        entry_ptr find(const std::string& key, uint64_t version, long ttl) const;
+
+        /**
+        Store the encoded response of key at version and return it
+        */
+        entry_ptr put(const std::string& key, uint64_t version, const std::string& body, const std::string& encoding = "");
+
+        /**
+        Drop all entries
+        */
+        void clear();
+
+        /**
+        Number of cached responses
+        */
+        size_t size() const;
+
+    private:
+        typedef std::list<std::string> lru_t;
+
+        struct Slot
+        {
+            entry_ptr entry;
+            uint64_t version;
+            Poco::Timestamp created;
+            lru_t::iterator lru;
+            // key and body bytes
+            size_t bytes;
+        };
+        typedef std::map<std::string, Slot> slots_t;
+
+        // drop a slot with m_mutex held
+        void erase(slots_t::iterator it) const;
+
+        const size_t m_max_bytes;
+        mutable size_t m_bytes;
+        mutable Poco::FastMutex m_mutex;
+        mutable slots_t m_slots;
+        // most recently used first
+        mutable lru_t m_lru;
+    };
+};
@@ -0,0 +1,121 @@
+#pragma once
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "headers.hpp"
+#include <Poco/DeflatingStream.h>
+#include <Poco/Net/HTTPServerResponse.h>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+
+namespace haystack
+{
+    /**
+    ResponseStream is the body stream of a HTTP response with optional
+    content encoding.
+
+    The first threshold bytes are buffered. A response which fits is sent
+    as is with a Content-Length, a larger one is sent compressed with the
+    negotiated encoding as it is written. close() must be called once the
+    body is complete.
+
+    A body of at most hold bytes may instead be taken back with take(),
+    unsent, so the caller can keep it. Larger bodies are still streamed.
+    */
+    class ResponseStream : public std::ostream
+    {
+    public:
+        enum Encoding { IDENTITY, GZIP, DEFLATE };
+
+        ResponseStream(Poco::Net::HTTPServerResponse& res, Encoding enc, int level, size_t threshold, size_t hold = 0);
+        ~ResponseStream();
+
+        /**
+        True while nothing was sent and the body written is held
+        */
+        bool held() const { return m_buf.held(); }
+
+        /**
+        Return the held body and close the stream without sending it
+        */
+        std::string take();
+
+        /**
+        Send what is buffered and finish the compressed stream
+        */
+        void close();
+
+        /**
+        Bytes of the body sent so far, after compression
+        */
+        size_t sent() const { return m_buf.sent(); }
+
+        /**
+        Preferred encoding of an Accept-Encoding header, gzip over deflate
+        */
+        static Encoding negotiate(const std::string& accept_encoding);
+
+        /**
+        Content-Encoding name of enc, empty for IDENTITY
+        */
+        static const std::string name(Encoding enc);
+
+        /**
+        Compress a whole body with enc
+        */
+        static std::string encode(const std::string& body, Encoding enc, int level);
+
+    private:
+        class Buf : public std::streambuf
+        {
+        public:
+            Buf(Poco::Net::HTTPServerResponse& res, Encoding enc, int level, size_t threshold, size_t hold);
+            void close();
+            std::string take();
+            bool held() const { return m_out == NULL && !m_closed; }
+            size_t sent() const { return m_wire.count; }
+
+        protected:
+            int overflow(int c);
+            std::streamsize xsputn(const char* s, std::streamsize n);
+            int sync();
+
+        private:
+            // counts the bytes passed on to the response stream
+            class Wire : public std::streambuf
+            {
+            public:
+                Wire() : dst(NULL), count(0) {}
+                std::streambuf* dst;
+                size_t count;
+            protected:
+                int overflow(int c);
+                std::streamsize xsputn(const char* s, std::streamsize n);
+                int sync();
+            };
+
+            // past the threshold, send the headers and start compressing
+            void start();
+
+            Poco::Net::HTTPServerResponse& m_res;
+            const Encoding m_enc;
+            const int m_level;
+            const size_t m_threshold;
+            // bytes held before streaming, at least m_threshold
+            const size_t m_hold;
+            std::string m_pending;
+            Wire m_wire;
+            std::ostream m_wire_os;
+            std::ostream* m_out;
+            std::auto_ptr<Poco::DeflatingOutputStream> m_deflate;
+            bool m_closed;
+        };
+
+        Buf m_buf;
+    };
+};
@@ -13,12 +13,20 @@
 #include "datetime.hpp"
 #include "proj.hpp"
 #include "watch.hpp"
+#include "hisrollup.hpp"
+#include "hisingest.hpp"
+#include "actionqueue.hpp"
+#include "responsecache.hpp"
+#include "admission.hpp"
+#include "slowquerylog.hpp"
+#include "datetimerange.hpp"
+#include "filterplan.hpp"
+#include <Poco/Timestamp.h>
 
 namespace haystack
 {
     class Num;
     class Op;
-    class DateTimeRange;
     class HisItem;
     class Uri;
 
@@ -59,9 +67,68 @@ namespace haystack
         typedef const_proj_iterator iterator;
         typedef const_proj_iterator const_iterator;
 
-        Server() { boot_time(); }
+        Server() : m_his_ingest(*this), m_actions(*this), m_stats_version(0), m_stats_building(false), m_compression_level(6), m_compression_threshold(1024) { boot_time(); }
 
         Dict::auto_ptr_t about() const;
+
+        /**
+        Version of the database, it must change whenever a record, the
+        navigation tree or a current value changes. Responses of cached
+        ops are only served for the version they were computed at.
+        The default, UNKNOWN_VERSION, disables the response cache.
+        */
+        virtual uint64_t version() const { return UNKNOWN_VERSION; }
+
+        static const uint64_t UNKNOWN_VERSION = ~(uint64_t)0;
+
+        /**
+        Encoded responses of the cacheable ops
+        */
+        ResponseCache& response_cache() const { return m_response_cache; }
+
+        /**
+        Storage queue of the history writes
+        */
+        const HisIngest& his_ingest() const { return m_his_ingest; }
+
+        /**
+        Admission control of the requests being computed
+        */
+        Admission& admission() const { return m_admission; }
+
+        /**
+        Filter reads which took longer than its threshold
+        */
+        SlowQueryLog& slow_queries() const { return m_slow_queries; }
+
+        /**
+        Tag frequencies of the records, rebuilt at most every
+        STATS_MAX_AGE millis after the version changed, or every
+        STATS_MAX_AGE millis if the version is unknown. One reader
+        rebuilds them without holding the lock, the others keep using
+        the previous stats meanwhile.
+        */
+        boost::shared_ptr<const TagStats> tag_stats() const;
+
+        enum { STATS_MAX_AGE = 10000 };
+
+        /**
+        Run a filter read and return its plan, one row per filter node
+        with the estimated selectivity and cost and the records it was
+        evaluated on and matched. The meta has the access path and the
+        records scanned and matched, the refs followed and the duration.
+        */
+        Grid::auto_ptr_t explain(const std::string& filter, size_t limit) const;
+
+        /**
+        Compression of responses to clients accepting it: the deflate
+        level 1-9, 0 disables compression, and the smallest body in bytes
+        worth compressing.
+        */
+        void compression(int level, size_t threshold) { m_compression_level = level; m_compression_threshold = threshold; }
+        int compression_level() const { return m_compression_level; }
+        size_t compression_threshold() const { return m_compression_threshold; }
+
         //////////////////////////////////////////////////////////////////////////
         // Operations
         //////////////////////////////////////////////////////////////////////////
@@ -171,6 +238,28 @@ namespace haystack
         Write to the given priority array level.
         */
         void point_write(const Ref& id, int level, const Val& val, const std::string& who, const Num& dur);
+
+        //
+        // Apply a batch of writes, one per row with "id", "level", "val",
+        // "who" and optional "duration" columns.  A bad row does not stop the
+        // others.  Return a grid with the "id", "level" and "status" ("ok" or
+        // "err") of each row and the error message in "dis".
+        //
+        Grid::auto_ptr_t point_write(const Grid& writes);
+
+        /**
+        One checked command of a batch pointWrite
+        */
+        struct PointWrite
+        {
+            const Dict* rec;
+            int level;
+            const Val* val;
+            std::string who;
+            const Num* dur;
+            // set by the implementation if the write failed
+            std::string err;
+        };
     protected:
         /**
         Implementation hook for pointWriteArray
@@ -182,6 +271,12 @@ namespace haystack
         */
         virtual void on_point_write(const Dict& rec, int level, const Val& val, const std::string& who, const Num& dur) = 0;
 
+        //
+        // Implementation hook for batch pointWrite, set err on the writes
+        // that fail.  The default calls on_point_write for each write.
+        //
+        virtual void on_point_write(std::vector<PointWrite>& writes);
+
     public:
         //////////////////////////////////////////////////////////////////////////
         // History
@@ -197,6 +292,22 @@ namespace haystack
         //
         Grid::auto_ptr_t his_read(const Ref& id, const std::string& range);
         //
+        // Read history time-series data for given record and time range
+        // reduced to interval buckets by the given rollup function:
+        // avg, min, max, sum, count, first or last. The result grid has
+        // one row per non empty bucket, labeled with the bucket start.
+        //
+        Grid::auto_ptr_t his_read(const Ref& id, const std::string& range, const Num& interval, const std::string& rollup);
+        //
+        // Read history time-series data for a batch of records over the
+        // same time range.  Records are resolved once, the range is parsed
+        // once per timezone and the series are read in parallel.  The result
+        // is a wide grid with a "ts" column followed by a "v0".."vN" column
+        // per record tagged with its id, rows are aligned on the union of
+        // timestamps and a point without a sample at a timestamp is null.
+        //
+        Grid::auto_ptr_t his_read(const boost::ptr_vector<Ref>& ids, const std::string& range);
+        //
         // Write a set of history time-series data to the given point record.
         // The record must already be defined and must be properly tagged as
         // a historized point.  The timestamp timezone must exactly match the
@@ -204,6 +315,21 @@ namespace haystack
         // inserted then they must be gracefully merged.
         //
         void his_write(const Ref& id, const std::vector<HisItem>& items);
+        //
+        // Write the "ts" and "val" columns of a grid to the given point record.
+        // Samples are checked against the point's "tz" and "kind" tags in one
+        // pass over the rows and queued to the storage pipeline, concurrent
+        // writes to the same point are coalesced.  Blocks until stored.
+        //
+        void his_write(const Ref& id, const Grid& items);
+        //
+        // Write history for many points in one call.  The grid is either in
+        // long form with "id", "ts" and "val" columns, or in wide form with a
+        // "ts" column and a column per point with the point id in the column
+        // meta, null cells are skipped.  Every sample is checked before any
+        // is queued, so a bad row rejects the whole request.
+        //
+        void his_write(const Grid& items);
 
     protected:
         //
@@ -212,11 +338,25 @@ namespace haystack
         //
         virtual std::vector<HisItem> on_his_read(const Dict& rec, const DateTimeRange& range) = 0;
 
+        //
+        // Implementation hook for rolled up hisRead. Feed the samples of
+        // the range to the rollup in timestamp order, the default routes
+        // through on_his_read.
+        //
+        virtual void on_his_rollup(const Dict& rec, const DateTimeRange& range, HisRollup& rollup);
+
         /**
         Implementation hook for onHisWrite.
         */
         virtual void on_his_write(const Dict& rec, const std::vector<HisItem>& items) = 0;
 
+        //
+        // Implementation hook for the his_write storage pipeline, called from
+        // a single worker thread with checked samples of one point in arrival
+        // order.  The default converts them to HisItems for on_his_write.
+        //
+        virtual void on_his_append(const Dict& rec, std::vector<HisChunk::Sample>& samples);
+
     public:
         //////////////////////////////////////////////////////////////////////////
         // Actions
@@ -234,18 +374,71 @@ namespace haystack
             return on_invoke_action(*rec, action, args);
         }
 
+        /**
+        Queue the action on the action executor and wait up to timeout
+        millis, or forever if negative, for it to finish. Return the action
+        result, or a grid with the job and jobStatus meta if it is still
+        queued or running.
+        */
+        Grid::auto_ptr_t invoke_action(const Ref& id, const std::string& action, const Dict& args, long timeout);
+
+        /**
+        Wait up to timeout millis for a queued action, see invoke_action.
+        */
+        Grid::auto_ptr_t job_status(const std::string& job, long timeout);
+
      protected:
          /**
          Implementation hook for invokeAction
          */
          virtual Grid::auto_ptr_t on_invoke_action(const Dict& rec, const std::string& action, const Dict& args) = 0;
 
+         /**
+         Stop the worker threads calling the hooks above. A derived server
+         must call it from its destructor, before its own state is gone.
+         */
+         void stop_workers();
+
     public:
         // Impl
 
         static const DateTime& boot_time();
 
     private:
+        // lookup and check a historized record, parse range in its timezone
+        Dict::auto_ptr_t his_rec(const Ref& id, const std::string& range, DateTimeRange::auto_ptr_t& r) const;
+        // check a historized record and parse range in its timezone
+        static DateTimeRange::auto_ptr_t his_range(const Dict& rec, const std::string& range);
+
+        // check a historized record and return its timezone
+        static std::auto_ptr<TimeZone> his_tz(const Dict& rec);
+
+        // reads one series of a batch hisRead
+        class HisReadTask;
+        // checked record and samples of a his_write
+        class HisPoint;
+
+        // match the records of f, through the id index if f names one,
+        // evaluating plan instead of f if given
+        void match(const Filter& f, FilterPlan* plan, size_t limit, std::vector<const Dict*>& recs,
+            boost::ptr_vector<Dict>& held, size_t& scanned, size_t& hops) const;
+
+        friend class HisIngest;
+        HisIngest m_his_ingest;
+
+        friend class ActionQueue;
+        ActionQueue m_actions;
+
+        mutable ResponseCache m_response_cache;
+        mutable Admission m_admission;
+        mutable SlowQueryLog m_slow_queries;
+        mutable Poco::FastMutex m_stats_lock;
+        mutable boost::shared_ptr<const TagStats> m_stats;
+        mutable uint64_t m_stats_version;
+        mutable Poco::Timestamp m_stats_time;
+        mutable bool m_stats_building;
+        int m_compression_level;
+        size_t m_compression_threshold;
 
         static const DateTime* m_boot_time;
     };
@@ -0,0 +1,65 @@
+#pragma once
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "headers.hpp"
+#include <Poco/Mutex.h>
+#include <deque>
+#include <vector>
+#include <stdint.h>
+
+namespace haystack
+{
+    /**
+    SlowQueryLog keeps the last filter reads which took longer than a
+    threshold, with the work they did, so a pathological filter can be
+    found after the fact. It holds at most capacity entries, dropping
+    the oldest.
+    */
+    class SlowQueryLog : boost::noncopyable
+    {
+    public:
+        struct Entry
+        {
+            // epoch millis the read finished
+            int64_t ts;
+            std::string filter;
+            std::string plan;
+            size_t scanned;
+            size_t matched;
+            size_t hops;
+            uint64_t micros;
+        };
+
+        SlowQueryLog(size_t capacity = 100, long threshold = 500);
+
+        /**
+        Keep at most capacity entries of reads taking threshold millis
+        or longer, a negative threshold disables the log
+        */
+        void configure(size_t capacity, long threshold);
+
+        /**
+        Record a read which took micros if it was slow
+        */
+        void record(const std::string& filter, const std::string& plan, size_t scanned, size_t matched, size_t hops, uint64_t micros);
+
+        /**
+        Copy the entries, newest first
+        */
+        std::vector<Entry> entries() const;
+
+        long threshold() const { return m_threshold; }
+
+    private:
+        size_t m_capacity;
+        volatile long m_threshold;
+
+        mutable Poco::FastMutex m_mutex;
+        std::deque<Entry> m_entries;
+    };
+};
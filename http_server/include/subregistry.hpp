@@ -0,0 +1,85 @@
+#pragma once
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "headers.hpp"
+#include "dict.hpp"
+#include <boost/ptr_container/ptr_map.hpp>
+#include <Poco/Mutex.h>
+#include <map>
+#include <vector>
+
+namespace haystack
+{
+    /**
+    SubRegistry keeps the watch subscriptions of a project per record.
+
+    Each subscribed record is resolved once and reference counted by the
+    subscribers interested in it; a change of the record is fanned out to
+    exactly those subscribers.
+    */
+    class SubRegistry : boost::noncopyable
+    {
+    public:
+        typedef boost::ptr_map<std::string, Dict> recs_t;
+
+        /**
+        Receiver of change notifications
+        */
+        class Subscriber
+        {
+        public:
+            virtual ~Subscriber() {}
+            /**
+            Called with the registry lock held, must not call back into it.
+            */
+            virtual void on_change(const std::string& id) = 0;
+        };
+
+        SubRegistry(const recs_t& recs) : m_recs(recs) {}
+
+        /**
+        Add the interest of s in ids. Fill recs with the record of each id
+        in order, NULL for unknown ids which are not subscribed.
+        The caller must not subscribe an id twice.
+        */
+        void sub(Subscriber& s, const std::vector<std::string>& ids, std::vector<const Dict*>& recs);
+
+        /**
+        Remove the interest of s in ids
+        */
+        void unsub(Subscriber& s, const std::vector<std::string>& ids);
+
+        /**
+        Fan out a change of the record to its subscribers
+        */
+        void notify(const std::string& id) const;
+
+        /**
+        Number of subscribers of the record
+        */
+        size_t refs(const std::string& id) const;
+
+        /**
+        Number of records with at least one subscriber
+        */
+        size_t size() const;
+
+    private:
+        struct Entry
+        {
+            Entry() : rec(NULL) {}
+            const Dict* rec;
+            std::vector<Subscriber*> subs;
+        };
+        typedef std::map<std::string, Entry> entries_t;
+
+        const recs_t& m_recs;
+        entries_t m_entries;
+        mutable Poco::FastMutex m_mutex;
+    };
+};
@@ -9,13 +9,23 @@
 //
 
 #include "server.hpp"
+#include "hischunk.hpp"
+#include "timerwheel.hpp"
+#include "subregistry.hpp"
+#include "priorityarray.hpp"
+#include "navtree.hpp"
 #include <Poco/AtomicCounter.h>
+#include <Poco/Condition.h>
+#include <Poco/Mutex.h>
 #include <Poco/RWLock.h>
 #include <Poco/Timer.h>
+#include <set>
+#include <stdint.h>
 
 namespace haystack
 {
     class Dict;
+    class TestWatch;
     //
     // TestProj provides a simple implementation of
     // Server with some test entities.
@@ -27,14 +37,24 @@ namespace haystack
 
         typedef boost::ptr_map<std::string, Dict> recs_t;
         typedef  std::map < std::string, Watch::shared_ptr > watches_t;
+        typedef boost::ptr_map<std::string, HisSeries> his_t;
+        typedef boost::ptr_map<std::string, Val> cur_vals_t;
+        typedef boost::ptr_map<std::string, PriorityArray> writes_t;
+        // max watch polls waiting for changes at once, each holds a worker thread
+        enum { MAX_PARKED_POLLS = 8 };
 
         TestProj();
+        ~TestProj();
         //////////////////////////////////////////////////////////////////////////
         // Ops
         //////////////////////////////////////////////////////////////////////////
         const std::vector<const Op*>& ops();
         const Op* const op(const std::string& name, bool checked = true) const;
+        // lookup by a name which is not a std::string, such as a slice of the request path
+        const Op* const op(const char* name, size_t len, bool checked = true) const;
         const Dict& on_about() const;
+        // current change version
+        uint64_t version() const;
     protected:
         //////////////////////////////////////////////////////////////////////////
         // Reads
@@ -67,12 +87,15 @@ namespace haystack
         Grid::auto_ptr_t on_point_write_array(const Dict& rec);
 
         void on_point_write(const Dict& rec, int level, const Val& val, const std::string& who, const Num& dur);
+        void on_point_write(std::vector<PointWrite>& writes);
 
         //////////////////////////////////////////////////////////////////////////
         // History
         //////////////////////////////////////////////////////////////////////////
 
         std::vector<HisItem> on_his_read(const Dict& entity, const DateTimeRange& range);
+        void on_his_rollup(const Dict& rec, const DateTimeRange& range, HisRollup& rollup);
+        void on_his_append(const Dict& rec, std::vector<HisChunk::Sample>& samples);
         void on_his_write(const Dict& rec, const std::vector<HisItem>& items);
 
         //////////////////////////////////////////////////////////////////////////
@@ -91,22 +114,61 @@ namespace haystack
         void add_meter(Dict& site, const std::string& dis);
         void add_ahu(Dict& site, const std::string& dis);
         void add_point(Dict& equip, const std::string& dis, const std::string& unit, const std::string& markers);
+        // insert a record and index it in the nav tree
+        void add_rec(Dict::auto_ptr_t rec);
         void on_timer(Poco::Timer& timer);
-        
+        void expire_writes();
+        // write a priority array level with m_write_lock held, return the
+        // new effective value if it changed
+        Val::auto_ptr_t write_level(const std::string& id, int level, const Val& val, const std::string& who, const Num* dur);
+        void expire_watches();
+
+        // set the current value of a point and record the change
+        void cur_val(const std::string& id, const Val& val);
+        // add the current value of a point to row
+        void add_cur_val(Dict& row, const std::string& id) const;
+        // wait up to timeout millis for a change after version since, false on timeout
+        bool wait_changes(uint64_t since, long timeout) const;
+        // restart the lease of a watch, expire it on the next tick if secs is 0
+        void renew(TestWatch& w, int secs) const;
+
         friend class TestWatch;
         recs_t m_recs;
+        // site, equip, point navigation of m_recs
+        NavTree m_nav;
+        // watch subscriptions per record, declared before the watches so
+        // it outlives them, a watch unsubscribes when destroyed
+        mutable SubRegistry m_subs;
         watches_t m_watches;
         Poco::RWLock m_lock;
         Poco::Timer m_timer;
+        // compressed history of each written point
+        his_t m_his;
+        Poco::RWLock m_his_lock;
+        // current values and the version of the last change
+        cur_vals_t m_cur_vals;
+        uint64_t m_version;
+        mutable Poco::Mutex m_cur_lock;
+        mutable Poco::Condition m_cur_changed;
+        mutable Poco::AtomicCounter m_parked_polls;
+        // watch leases, one tick per second
+        mutable TimerWheel m_leases;
+        mutable Poco::FastMutex m_lease_lock;
+        // priority arrays of the written points and their timed writes,
+        // one tick per second
+        writes_t m_writes;
+        TimerWheel m_write_timers;
+        Poco::FastMutex m_write_lock;
 
         static Dict* m_about;
         static std::vector<const Op*>* m_ops;
     };
 
-    class TestWatch : public Watch
+    class TestWatch : public Watch, public TimerWheel::Entry, public SubRegistry::Subscriber
     {
     public:
         TestWatch(const TestProj& server, const std::string& dis);
+        ~TestWatch();
 
         const std::string id() const;
         const std::string dis() const;
@@ -115,17 +177,39 @@ namespace haystack
         Grid::auto_ptr_t sub(const refs_t& ids, bool checked = true);
         void unsub(const refs_t& ids);
         Grid::auto_ptr_t poll_changes();
+        Grid::auto_ptr_t poll_changes(long timeout);
+        Grid::auto_ptr_t stream_changes(long timeout);
         Grid::auto_ptr_t poll_refresh();
         void close();
         bool is_open() const;
 
     private:
+        friend class TestProj;
+        typedef std::map<std::string, const Dict*> ids_t;
+
+        Grid::auto_ptr_t make_grid(const std::vector<const Dict*>& recs);
+        void on_change(const std::string& id);
+        // wait up to timeout millis for a change of a subscribed record
+        Grid::auto_ptr_t wait_changes(long timeout);
+        // drop all subscriptions
+        void release();
+
         const TestProj& m_server;
         const std::string m_uuid;
         const std::string m_dis;
-        refs_t m_ids;
+        // subscribed records
+        ids_t m_ids;
+        // change version seen by the last poll
+        uint64_t m_version;
+        Poco::Mutex m_mutex;
+        // records changed since the last poll, filled by the registry
+        std::set<std::string> m_pending;
+        Poco::FastMutex m_pending_lock;
         Poco::AtomicCounter m_lease;
-        bool m_is_open;
+        // 1 while open, set by the lease timer and read by the serving threads
+        Poco::AtomicCounter m_is_open;
+        // set once the lease ran out, guarded by the project lease lock
+        bool m_expired;
 
     };
 }
\ No newline at end of file
@@ -61,6 +61,20 @@ namespace haystack {
         */
         virtual Grid::auto_ptr_t poll_changes() = 0;
 
+        /**
+        Poll for any changes to the subscribed records, if there are none
+        wait up to timeout millis for one of them to change.
+        The default implementation does not wait.
+        */
+        virtual Grid::auto_ptr_t poll_changes(long timeout) { return poll_changes(); }
+
+        /**
+        Like poll_changes(timeout) for a watch stream. Streams are bounded
+        by the watchStream op, so they do not use up the waits a server
+        allows for parked polls.
+        */
+        virtual Grid::auto_ptr_t stream_changes(long timeout) { return poll_changes(timeout); }
+
         /**
         Poll all the subscribed records even if there have been no changes.
         */
@@ -0,0 +1,188 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "actionqueue.hpp"
+#include "server.hpp"
+#include <Poco/ScopedUnlock.h>
+#include <Poco/Timestamp.h>
+#include <boost/lexical_cast.hpp>
+#include <boost/uuid/uuid_io.hpp>
+
+////////////////////////////////////////////////
+// ActionQueue
+////////////////////////////////////////////////
+using namespace haystack;
+
+ActionQueue::ActionQueue(Server& server, size_t capacity, size_t threads, size_t retain)
+    : m_server(server),
+    m_capacity(capacity),
+    m_threads(threads > 0 ? threads : 1),
+    m_retain(retain),
+    m_stop(false)
+{
+}
+
+ActionQueue::~ActionQueue()
+{
+    stop();
+}
+
+void ActionQueue::stop()
+{
+    {
+        Poco::Mutex::ScopedLock l(m_mutex);
+        m_stop = true;
+        m_ready.broadcast();
+    }
+    for (size_t i = 0; i < m_workers.size(); ++i)
+        m_workers[i].join();
+
+    Poco::Mutex::ScopedLock l(m_mutex);
+    m_workers.clear();
+
+    // fail the jobs which never ran, their waiters return
+    while (!m_queue.empty())
+    {
+        Job& j = *m_queue.front();
+        m_queue.pop_front();
+        j.status = FAILED;
+        j.error = "Action queue stopped";
+    }
+    m_done.broadcast();
+}
+
+std::string ActionQueue::submit(const Ref& id, const std::string& action, const Dict& args)
+{
+    Poco::Mutex::ScopedLock l(m_mutex);
+
+    if (m_stop)
+        throw std::runtime_error("Action queue stopped");
+    if (m_queue.size() >= m_capacity)
+        throw std::runtime_error("Action queue full, try again later");
+
+    // workers are started on first use
+    while (m_workers.size() < m_threads)
+    {
+        m_workers.push_back(new Poco::Thread("invokeAction"));
+        m_workers.back().start(*this);
+    }
+
+    std::string job = "job-" + boost::lexical_cast<std::string>(m_ids());
+    Job* j = new Job(job, id, action, args);
+    m_jobs.insert(job, j);
+    m_queue.push_back(j);
+    m_ready.signal();
+
+    return job;
+}
+
+ActionQueue::Status ActionQueue::wait(const std::string& job, long timeout, Grid::auto_ptr_t& result) const
+{
+    Poco::Mutex::ScopedLock l(m_mutex);
+
+    const Poco::Timestamp start;
+    // lookup again after each wake up, the job may have been retired
+    while (find(job).status < DONE)
+    {
+        if (timeout < 0)
+        {
+            m_done.wait(m_mutex);
+            continue;
+        }
+        const long left = timeout - (long)(start.elapsed() / 1000);
+        if (left <= 0 || !m_done.tryWait(m_mutex, left))
+        {
+            const Status status = find(job).status;
+            if (status < DONE)
+                return status;
+        }
+    }
+
+    const Job& j = find(job);
+    if (j.status == FAILED)
+        throw std::runtime_error(j.error);
+
+    result.reset(j.result.get() == NULL ? NULL : new GridView(j.result));
+    return DONE;
+}
+
+ActionQueue::Status ActionQueue::status(const std::string& job) const
+{
+    Poco::Mutex::ScopedLock l(m_mutex);
+    return find(job).status;
+}
+
+size_t ActionQueue::pending() const
+{
+    Poco::Mutex::ScopedLock l(m_mutex);
+    return m_queue.size();
+}
+
+const std::string ActionQueue::status_name(Status status)
+{
+    switch (status)
+    {
+    case PENDING: return "pending";
+    case RUNNING: return "running";
+    case DONE: return "done";
+    case FAILED: return "failed";
+    }
+    return "";
+}
+
+void ActionQueue::run()
+{
+    Poco::Mutex::ScopedLock l(m_mutex);
+    for (;;)
+    {
+        while (m_queue.empty() && !m_stop)
+            m_ready.wait(m_mutex);
+
+        if (m_stop)
+            return;
+
+        Job& j = *m_queue.front();
+        m_queue.pop_front();
+        j.status = RUNNING;
+
+        Grid::auto_ptr_t g;
+        std::string error;
+        {
+            Poco::ScopedUnlock<Poco::Mutex> u(m_mutex);
+            try
+            {
+                Dict::auto_ptr_t rec = m_server.read_by_id(Ref(j.id));
+                g = m_server.on_invoke_action(*rec, j.action, *j.args);
+            }
+            catch (std::exception& ex)
+            {
+                error = ex.what();
+            }
+        }
+
+        j.result.reset(g.release());
+        j.error = error;
+        j.status = error.empty() ? DONE : FAILED;
+
+        // retire the oldest finished jobs
+        m_finished.push_back(j.name);
+        while (m_finished.size() > m_retain)
+        {
+            m_jobs.erase(m_finished.front());
+            m_finished.pop_front();
+        }
+        m_done.broadcast();
+    }
+}
+
+const ActionQueue::Job& ActionQueue::find(const std::string& job) const
+{
+    jobs_t::const_iterator it = m_jobs.find(job);
+    if (it == m_jobs.end())
+        throw std::runtime_error("Unknown job: " + job);
+    return *it->second;
+}
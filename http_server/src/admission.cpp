@@ -0,0 +1,124 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "admission.hpp"
+#include <Poco/Timestamp.h>
+
+////////////////////////////////////////////////
+// Admission
+////////////////////////////////////////////////
+using namespace haystack;
+
+Admission::Admission() : m_workers(0), m_rejected(0)
+{
+    // latency critical ops are never queued, bulk ops share few workers
+    limit(HIGH, 0, 0);
+    limit(NORMAL, 8, 5000);
+    limit(LOW, 4, 2000);
+}
+
+void Admission::limit(Priority p, size_t max, long queue_time)
+{
+    Poco::Mutex::ScopedLock l(m_mutex);
+    m_classes[p].max = max;
+    m_queue_time[p] = queue_time;
+    m_left.broadcast();
+}
+
+void Admission::workers(size_t n)
+{
+    Poco::Mutex::ScopedLock l(m_mutex);
+    m_workers = n;
+}
+
+void Admission::limit(const std::string& op, size_t max)
+{
+    Poco::Mutex::ScopedLock l(m_mutex);
+    if (max == 0)
+    {
+        std::map<std::string, Slots>::iterator it = m_ops.find(op);
+        if (it != m_ops.end() && it->second.active == 0)
+            m_ops.erase(it);
+        else if (it != m_ops.end())
+            it->second.max = 0;
+    }
+    else
+    {
+        m_ops[op].max = max;
+    }
+    m_left.broadcast();
+}
+
+bool Admission::enter(const std::string& op, Priority p)
+{
+    Poco::Mutex::ScopedLock l(m_mutex);
+
+    Slots& c = m_classes[p];
+    if (!admits(c, op))
+    {
+        // a waiter holds a worker, leave at least one for the other classes
+        if (m_workers > 0 && c.active + c.waiting + 1 >= m_workers)
+        {
+            ++m_rejected;
+            return false;
+        }
+
+        ++c.waiting;
+        const Poco::Timestamp start;
+        bool admitted = true;
+        while (!admits(c, op))
+        {
+            const long left = m_queue_time[p] - (long)(start.elapsed() / 1000);
+            if (left <= 0 || !m_left.tryWait(m_mutex, left))
+            {
+                admitted = admits(c, op);
+                break;
+            }
+        }
+        --c.waiting;
+
+        if (!admitted)
+        {
+            ++m_rejected;
+            return false;
+        }
+    }
+
+    ++c.active;
+    // looked up again, the op limit may have been removed while waiting
+    std::map<std::string, Slots>::iterator it = m_ops.find(op);
+    if (it != m_ops.end())
+        ++it->second.active;
+    return true;
+}
+
+bool Admission::admits(const Slots& c, const std::string& op) const
+{
+    if (!c.free())
+        return false;
+    std::map<std::string, Slots>::const_iterator it = m_ops.find(op);
+    return it == m_ops.end() || it->second.free();
+}
+
+void Admission::leave(const std::string& op, Priority p)
+{
+    Poco::Mutex::ScopedLock l(m_mutex);
+
+    --m_classes[p].active;
+    // the op may have been limited after this request entered
+    std::map<std::string, Slots>::iterator it = m_ops.find(op);
+    if (it != m_ops.end() && it->second.active > 0)
+        --it->second.active;
+
+    m_left.broadcast();
+}
+
+size_t Admission::rejected() const
+{
+    Poco::Mutex::ScopedLock l(m_mutex);
+    return m_rejected;
+}
@@ -0,0 +1,71 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "bodybuffer.hpp"
+
+////////////////////////////////////////////////
+// BodyBuffer
+////////////////////////////////////////////////
+using namespace haystack;
+
+Poco::FastMutex BodyBuffer::s_mutex;
+std::vector<std::vector<char>*> BodyBuffer::s_pool;
+
+BodyBuffer::BodyBuffer() : m_buf(NULL), m_size(0)
+{
+    {
+        Poco::FastMutex::ScopedLock l(s_mutex);
+        if (!s_pool.empty())
+        {
+            m_buf = s_pool.back();
+            s_pool.pop_back();
+        }
+    }
+
+    if (m_buf == NULL)
+        m_buf = new std::vector<char>();
+}
+
+BodyBuffer::~BodyBuffer()
+{
+    if (m_buf->capacity() <= MAX_POOLED_CAPACITY)
+    {
+        Poco::FastMutex::ScopedLock l(s_mutex);
+        if (s_pool.size() < MAX_POOLED)
+        {
+            s_pool.push_back(m_buf);
+            return;
+        }
+    }
+    delete m_buf;
+}
+
+bool BodyBuffer::read(std::istream& is, std::streamsize length, size_t max)
+{
+    m_size = 0;
+
+    if (length >= 0 && (size_t)length > max)
+        return false;
+
+    // grow as the data arrives, a Content-Length alone reserves nothing
+    while (is.good() && (length < 0 || m_size < (size_t)length))
+    {
+        if (m_size > max)
+            return false;
+
+        size_t n = CHUNK;
+        if (length >= 0 && (size_t)length - m_size < n)
+            n = (size_t)length - m_size;
+
+        if (m_buf->size() < m_size + n)
+            m_buf->resize(m_size + n);
+        is.read(&(*m_buf)[m_size], (std::streamsize)n);
+        m_size += (size_t)is.gcount();
+    }
+
+    return m_size <= max;
+}
@@ -54,15 +54,22 @@
 #include "Poco/Util/Option.h"
 #include "Poco/Util/OptionSet.h"
 #include "Poco/Util/HelpFormatter.h"
+#include "Poco/Logger.h"
+#include "Poco/Mutex.h"
+#include "Poco/Timespan.h"
 #include "Poco/URI.h"
 
 #include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <vector>
 
 #include <boost/algorithm/string.hpp>
 
 // haystack includes
 #include "testproj.hpp"
 #include "op.hpp"
+#include "trace.hpp"
 
 
 using Poco::Timestamp;
@@ -83,36 +90,90 @@ using Poco::Util::OptionSet;
 using Poco::Util::HelpFormatter;
 
 
-class HaystackRequestHandler : public HTTPRequestHandler
+// Log a request at information level, the message is only formatted
+// when that level is enabled.
+static void log_request(const HTTPServerRequest& request, const std::string& path)
+{
+    Poco::Logger& logger = Application::instance().logger();
+    if (!logger.information())
+        return;
+
+    logger.information("Request: [" + request.getMethod() + "] " + path + " from: " + request.clientAddress().toString());
+}
+
+template <class T>
+class Recycled
+    /// Recycles the memory of request handlers, Poco deletes the handler
+    /// of each request once it is served.
+{
+public:
+    static void* operator new(size_t size)
+    {
+        if (size == sizeof(T))
+        {
+            Poco::FastMutex::ScopedLock l(s_mutex);
+            if (!s_free.empty())
+            {
+                void* p = s_free.back();
+                s_free.pop_back();
+                return p;
+            }
+        }
+        return ::operator new(size);
+    }
+
+    static void operator delete(void* p, size_t size)
+    {
+        if (p == NULL)
+            return;
+
+        if (size == sizeof(T))
+        {
+            Poco::FastMutex::ScopedLock l(s_mutex);
+            if (s_free.size() < MAX_FREE)
+            {
+                s_free.push_back(p);
+                return;
+            }
+        }
+        ::operator delete(p);
+    }
+
+private:
+    enum { MAX_FREE = 256 };
+    static Poco::FastMutex s_mutex;
+    static std::vector<void*> s_free;
+};
+
+template <class T> Poco::FastMutex Recycled<T>::s_mutex;
+template <class T> std::vector<void*> Recycled<T>::s_free;
+
+class HaystackRequestHandler : public HTTPRequestHandler, public Recycled<HaystackRequestHandler>
     /// Return the Zinc encoded grid for the invoked Haystack Op.
 {
 public:
-    HaystackRequestHandler(haystack::TestProj& proj) : _proj(proj)
+    HaystackRequestHandler(haystack::TestProj& proj, const std::string& path) : _proj(proj), _path(path)
     {
     }
 
     void handleRequest(HTTPServerRequest& request, HTTPServerResponse& response)
     {
-        Application& app = Application::instance();
-
-        const std::string path = Poco::URI(request.getURI()).getPath();
-        app.logger().information("Request: [" + request.getMethod() + "] " + path + " from: " + request.clientAddress().toString());
+        log_request(request, _path);
 
-        if (path == "" || path == "/")
+        if (_path == "" || _path == "/")
         {
             response.redirect("/about");
             return;
         }
 
-        size_t slash = path.find('/', 1);
-        if (slash == path.npos)
-            slash = path.size();
+        size_t slash = _path.find('/', 1);
+        if (slash == _path.npos)
+            slash = _path.size();
 
         response.setChunkedTransferEncoding(true);
-        
-        std::string op_name = path.substr(1, slash);
 
-        haystack::Op* op = (haystack::Op*)_proj.op(op_name, false);
+        // op name is the first path segment, looked up in place
+        haystack::Op* op = (haystack::Op*)_proj.op(_path.data() + 1, slash - 1, false);
         if (op == NULL)
         {
             response.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_NOT_FOUND);
@@ -120,21 +181,21 @@ public:
             return;
         }
 
-        //Timestamp now;
         op->on_service(_proj, request, response);
     }
 
 private:
     haystack::TestProj& _proj;
+    const std::string _path;
 };
 
-class AuthRequestHandler : public Poco::Net::AbstractHTTPRequestHandler
+class AuthRequestHandler : public Poco::Net::AbstractHTTPRequestHandler, public Recycled<AuthRequestHandler>
     /// Handle the /auth request.
     /// A HTTP Basic Auth sample.
 {
 public:
-    AuthRequestHandler(haystack::TestProj& proj) :
-        m_proj(proj){}
+    AuthRequestHandler(haystack::TestProj& proj, const std::string& path) :
+        m_proj(proj), m_path(path){}
 
     void handleRequest(HTTPServerRequest& request, HTTPServerResponse& response)
     {
@@ -143,34 +204,29 @@ public:
 
     void run()
     {
-        Application& app = Application::instance();
-
-        std::string path = Poco::URI(request().getURI()).getPath();
-        app.logger().information("Request: [" + request().getMethod() + "] " + path + " from: " + request().clientAddress().toString());
+        log_request(request(), m_path);
 
-        if (path == "/auth" || path == "/auth/")
+        if (m_path == "/auth" || m_path == "/auth/")
         {
             response().redirect("/auth/about");
             return;
         }
 
-        path = path.substr(path.find("/auth/") + 6 );
-
-        size_t slash = path.find('/');
-        if (slash == path.npos)
-            slash = path.size();
+        // skip "/auth/"
+        const size_t start = 6;
+        size_t slash = m_path.find('/', start);
+        if (slash == m_path.npos)
+            slash = m_path.size();
 
         response().setChunkedTransferEncoding(true);
-        std::string op_name = path.substr(0, slash);
 
-        haystack::Op* op = (haystack::Op*)m_proj.op(op_name, false);
+        haystack::Op* op = (haystack::Op*)m_proj.op(m_path.data() + start, slash - start, false);
         if (op == NULL)
         {
-            this->sendErrorResponse(Poco::Net::HTTPResponse::HTTP_NOT_FOUND, "Operation '" + op_name + "' not defined");
+            this->sendErrorResponse(Poco::Net::HTTPResponse::HTTP_NOT_FOUND, "Operation '" + m_path.substr(start) + "' not defined");
             return;
         }
 
-        //Timestamp now;
         op->on_service(m_proj, request(), response());
     }
 
@@ -200,6 +256,7 @@ public:
 
 private:
     haystack::TestProj& m_proj;
+    const std::string m_path;
 };
 
 
@@ -213,12 +270,29 @@ public:
 
     HTTPRequestHandler* createRequestHandler(const HTTPServerRequest& request)
     {
-        const std::string path = Poco::URI(request.getURI()).getPath();
+        // the path is parsed once here and handed to the handler
+        const std::string& uri = request.getURI();
+        std::string path = uri.substr(0, uri.find_first_of("?#"));
+
+        // op names may arrive percent-encoded, most paths have nothing to decode
+        if (path.find('%') != path.npos)
+        {
+            try
+            {
+                std::string decoded;
+                Poco::URI::decode(path, decoded);
+                path.swap(decoded);
+            }
+            catch (Poco::Exception&)
+            {
+                // a bad escape names no op, left as is for the 404
+            }
+        }
 
         if (boost::starts_with(path, "/auth"))
-            return new AuthRequestHandler(_proj);
+            return new AuthRequestHandler(_proj, path);
         else 
-            return new HaystackRequestHandler(_proj);
+            return new HaystackRequestHandler(_proj, path);
     }
 
 private:
@@ -303,20 +377,57 @@ protected:
         {
             // get parameters from configuration file
             unsigned short port = (unsigned short)config().getInt("haystack_server.port", 8085);
+            int backlog = config().getInt("haystack_server.backlog", 64);
             int maxQueued = config().getInt("haystack_server.maxQueued", 100);
             int maxThreads = config().getInt("haystack_server.maxThreads", 16);
-            ThreadPool::defaultPool().addCapacity(maxThreads);
+            int minThreads = config().getInt("haystack_server.minThreads", 2);
+            int threadIdleTime = config().getInt("haystack_server.threadIdleTime", 60);
+            bool keepAlive = config().getBool("haystack_server.keepAlive", true);
+            int keepAliveTimeout = config().getInt("haystack_server.keepAliveTimeout", 10);
+            int maxKeepAliveRequests = config().getInt("haystack_server.maxKeepAliveRequests", 0);
+            int timeout = config().getInt("haystack_server.timeout", 60);
+
+            // dedicated pool for the connections, the default pool is left
+            // to the rest of the application
+            ThreadPool pool("http", std::min(minThreads, maxThreads), maxThreads, threadIdleTime);
 
             HTTPServerParams* pParams = new HTTPServerParams;
             pParams->setMaxQueued(maxQueued);
             pParams->setMaxThreads(maxThreads);
-            pParams->setKeepAlive(true);
+            pParams->setThreadIdleTime(Poco::Timespan(threadIdleTime, 0));
+            pParams->setKeepAlive(keepAlive);
+            pParams->setKeepAliveTimeout(Poco::Timespan(keepAliveTimeout, 0));
+            // 0 means no limit
+            pParams->setMaxKeepAliveRequests(maxKeepAliveRequests);
+            pParams->setTimeout(Poco::Timespan(timeout, 0));
 
             // set-up a server socket
-            ServerSocket svs(port);
+            ServerSocket svs(port, backlog);
             haystack::TestProj proj;
+            proj.compression(config().getInt("haystack_server.compressionLevel", 6),
+                config().getInt("haystack_server.compressionThreshold", 1024));
+
+            // admission control of the normal and bulk (low) priority ops,
+            // high priority ops are never queued
+            haystack::Admission& admission = proj.admission();
+            admission.workers(maxThreads);
+            admission.limit(haystack::Admission::NORMAL,
+                config().getInt("haystack_server.normalLimit", 8),
+                config().getInt("haystack_server.normalQueueTime", 5000));
+            admission.limit(haystack::Admission::LOW,
+                config().getInt("haystack_server.lowLimit", 4),
+                config().getInt("haystack_server.lowQueueTime", 2000));
+            const std::vector<const haystack::Op*>& ops = proj.ops();
+            for (std::vector<const haystack::Op*>::const_iterator it = ops.begin(), e = ops.end(); it != e; ++it)
+            {
+                const std::string name = (*it)->name();
+                admission.limit(name, config().getInt("haystack_server.opLimit." + name, 0));
+            }
+            proj.slow_queries().configure(config().getInt("haystack_server.slowQueryLog", 100),
+                config().getInt("haystack_server.slowQueryTime", 500));
+
             // set-up a HTTPServer instance
-            HTTPServer srv(new HaystackRequestHandlerFactory(proj), svs, pParams);
+            HTTPServer srv(new HaystackRequestHandlerFactory(proj), pool, svs, pParams);
             // start the HTTPServer
             srv.start();
             std::cout << "Haystack++ HTTP Demo Server running... \n";
@@ -324,6 +435,15 @@ protected:
             waitForTerminationRequest();
             // Stop the HTTPServer
             srv.stop();
+            pool.joinAll();
+
+            // dump the trace spans, open the file in chrome://tracing
+            const std::string traceFile = config().getString("haystack_server.traceFile", "");
+            if (!traceFile.empty())
+            {
+                std::ofstream os(traceFile.c_str());
+                haystack::Trace::write_json(os);
+            }
         }
         return Application::EXIT_OK;
     }
@@ -0,0 +1,194 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "hisingest.hpp"
+#include "server.hpp"
+#include <Poco/ScopedUnlock.h>
+#include <Poco/Timestamp.h>
+
+////////////////////////////////////////////////
+// HisIngest
+////////////////////////////////////////////////
+using namespace haystack;
+
+HisIngest::HisIngest(Server& server, size_t capacity, long timeout)
+    : m_server(server),
+    m_capacity(capacity),
+    m_timeout(timeout),
+    m_pending(0),
+    m_failed(0),
+    m_running(false),
+    m_stop(false),
+    m_thread("hisWrite")
+{
+}
+
+HisIngest::~HisIngest()
+{
+    stop();
+}
+
+void HisIngest::stop()
+{
+    {
+        Poco::Mutex::ScopedLock l(m_mutex);
+        m_stop = true;
+        if (!m_running)
+            return;
+        m_ready.signal();
+    }
+    m_thread.join();
+
+    Poco::Mutex::ScopedLock l(m_mutex);
+    m_running = false;
+}
+
+size_t HisIngest::pending() const
+{
+    Poco::Mutex::ScopedLock l(m_mutex);
+    return m_pending;
+}
+
+size_t HisIngest::failed() const
+{
+    Poco::Mutex::ScopedLock l(m_mutex);
+    return m_failed;
+}
+
+void HisIngest::submit(const Dict& rec, std::vector<HisChunk::Sample>& samples)
+{
+    std::vector<const Dict*> recs(1, &rec);
+    std::vector<std::vector<HisChunk::Sample> > batch(1);
+    batch[0].swap(samples);
+    submit(recs, batch);
+}
+
+void HisIngest::submit(const std::vector<const Dict*>& recs, std::vector<std::vector<HisChunk::Sample> >& samples)
+{
+    size_t total = 0;
+    for (size_t i = 0; i < samples.size(); ++i)
+        total += samples[i].size();
+    if (total == 0)
+        return;
+
+    // shared with the batches, which may outlive a writer timing out
+    const boost::shared_ptr<Ticket> ticket(new Ticket);
+    Poco::Mutex::ScopedLock l(m_mutex);
+
+    if (m_stop)
+        throw std::runtime_error("His write queue stopped");
+    if (!m_running)
+    {
+        m_thread.start(*this);
+        m_running = true;
+    }
+
+    // backpressure, a batch larger than the capacity still goes
+    // through once the queue is empty
+    const Poco::Timestamp start;
+    while (m_pending > 0 && m_pending + total > m_capacity)
+    {
+        const long left = m_timeout - (long)(start.elapsed() / 1000);
+        if (left <= 0 || !m_stored.tryWait(m_mutex, left))
+        {
+            if (m_pending > 0 && m_pending + total > m_capacity)
+                throw std::runtime_error("His write queue full, try again later");
+        }
+    }
+
+    for (size_t i = 0; i < recs.size(); ++i)
+    {
+        std::vector<HisChunk::Sample>& s = samples[i];
+        if (s.empty())
+            continue;
+
+        // coalesce with writes to the same point not yet picked up
+        const std::string& id = recs[i]->id().value;
+        queue_t::iterator it = m_queue.find(id);
+        if (it == m_queue.end())
+        {
+            std::string k(id);
+            it = m_queue.insert(k, new Batch(*recs[i])).first;
+        }
+
+        Batch& b = *it->second;
+        const size_t count = s.size();
+        if (b.samples.empty())
+            b.samples.swap(s);
+        else
+            b.samples.insert(b.samples.end(), s.begin(), s.end());
+        b.count += count;
+        b.tickets.push_back(ticket);
+        ++ticket->remaining;
+    }
+    m_pending += total;
+    m_ready.signal();
+
+    // the samples stay queued if the writer gives up
+    const Poco::Timestamp queued;
+    while (ticket->remaining > 0)
+    {
+        const long left = m_timeout - (long)(queued.elapsed() / 1000);
+        if (left <= 0 || !m_stored.tryWait(m_mutex, left))
+        {
+            if (ticket->remaining > 0)
+                throw std::runtime_error("His write not stored in time, it is still queued");
+        }
+    }
+
+    if (!ticket->error.empty())
+        throw std::runtime_error(ticket->error);
+}
+
+void HisIngest::run()
+{
+    Poco::Mutex::ScopedLock l(m_mutex);
+    for (;;)
+    {
+        while (m_queue.empty() && !m_stop)
+            m_ready.wait(m_mutex);
+
+        if (m_queue.empty())
+            return;
+
+        // take everything queued so far, writers keep queuing meanwhile
+        queue_t work;
+        work.swap(m_queue);
+
+        {
+            Poco::ScopedUnlock<Poco::Mutex> u(m_mutex);
+            for (queue_t::iterator it = work.begin(), e = work.end(); it != e; ++it)
+            {
+                Batch& b = *it->second;
+                try
+                {
+                    m_server.on_his_append(*b.rec, b.samples);
+                }
+                catch (std::exception& ex)
+                {
+                    b.error = it->first + ": " + ex.what();
+                }
+            }
+        }
+
+        for (queue_t::iterator it = work.begin(), e = work.end(); it != e; ++it)
+        {
+            Batch& b = *it->second;
+            m_pending -= b.count;
+            if (!b.error.empty())
+                ++m_failed;
+            for (size_t i = 0; i < b.tickets.size(); ++i)
+            {
+                Ticket& t = *b.tickets[i];
+                if (!b.error.empty() && t.error.empty())
+                    t.error = b.error;
+                --t.remaining;
+            }
+        }
+        m_stored.broadcast();
+    }
+}
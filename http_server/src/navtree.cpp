@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "navtree.hpp"
+#include "ref.hpp"
+#include "str.hpp"
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <algorithm>
+
+namespace
+{
+    using haystack::Dict;
+
+    bool id_less(const Dict* a, const Dict* b)
+    {
+        return a->id().value < b->id().value;
+    }
+}
+
+////////////////////////////////////////////////
+// NavTree
+////////////////////////////////////////////////
+using namespace haystack;
+
+void NavTree::add(const Dict& rec)
+{
+    std::string p;
+    const bool child = parent(rec, p);
+
+    Poco::FastMutex::ScopedLock l(m_mutex);
+
+    m_nodes[rec.id().value].rec = &rec;
+    if (!child)
+        return;
+
+    Node& n = m_nodes[p];
+    std::vector<const Dict*>::iterator pos = std::lower_bound(n.children.begin(), n.children.end(), &rec, id_less);
+    if (pos != n.children.end() && (*pos)->id().value == rec.id().value)
+        *pos = &rec;
+    else
+        n.children.insert(pos, &rec);
+    n.grid.reset();
+}
+
+void NavTree::remove(const Dict& rec)
+{
+    std::string p;
+    const bool child = parent(rec, p);
+
+    Poco::FastMutex::ScopedLock l(m_mutex);
+
+    nodes_t::iterator it = m_nodes.find(rec.id().value);
+    if (it != m_nodes.end())
+    {
+        if (it->second.children.empty())
+            m_nodes.erase(it);
+        else
+            it->second.rec = NULL;
+    }
+
+    if (!child)
+        return;
+
+    it = m_nodes.find(p);
+    if (it == m_nodes.end())
+        return;
+
+    Node& n = it->second;
+    std::vector<const Dict*>::iterator pos = std::lower_bound(n.children.begin(), n.children.end(), &rec, id_less);
+    if (pos != n.children.end() && (*pos)->id().value == rec.id().value)
+    {
+        n.children.erase(pos);
+        n.grid.reset();
+    }
+}
+
+boost::shared_ptr<const Grid> NavTree::children(const std::string& nav_id) const
+{
+    Poco::FastMutex::ScopedLock l(m_mutex);
+
+    nodes_t::iterator it = m_nodes.find(nav_id);
+    if (it == m_nodes.end() || (it->second.rec == NULL && !nav_id.empty()))
+        return nav_id.empty() ? children_grid(Node()) : boost::shared_ptr<const Grid>();
+
+    Node& n = it->second;
+    if (n.grid.get() == NULL)
+        n.grid = children_grid(n);
+    return n.grid;
+}
+
+boost::shared_ptr<const Grid> NavTree::children_grid(const Node& n)
+{
+    // children tags plus the navId column
+    boost::ptr_vector<Dict> rows(n.children.size());
+    for (std::vector<const Dict*>::const_iterator it = n.children.begin(), e = n.children.end(); it != e; ++it)
+    {
+        Dict* d = new Dict;
+        rows.push_back(d);
+        d->add(**it).add("navId", (*it)->id().value);
+    }
+
+    Grid::auto_ptr_t g = Grid::make(rows);
+    if (g->num_cols() == 0)
+        g->add_col("navId");
+    return boost::shared_ptr<const Grid>(g.release());
+}
+
+bool NavTree::parent(const Dict& rec, std::string& nav_id)
+{
+    if (rec.has("site"))
+    {
+        nav_id.clear();
+        return true;
+    }
+    if (rec.has("equip") && rec.has("siteRef"))
+    {
+        nav_id = rec.get_ref("siteRef").value;
+        return true;
+    }
+    if (rec.has("point") && rec.has("equipRef"))
+    {
+        nav_id = rec.get_ref("equipRef").value;
+        return true;
+    }
+    return false;
+}
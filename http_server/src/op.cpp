@@ -19,65 +19,277 @@
 #include "hisitem.hpp"
 #include "server.hpp"
 #include "watch.hpp"
+#include "responsestream.hpp"
+#include "bodybuffer.hpp"
+#include "trace.hpp"
 
 // std
 #include <sstream>
+#include <algorithm>
+#include <map>
 #include <stdio.h>
 // poco
 #include "Poco/Net/HTTPResponse.h"
-#include "Poco/Net/HTMLForm.h"
-#include "Poco/Net/NameValueCollection.h"
+#include "Poco/AtomicCounter.h"
+#include "Poco/Thread.h"
+#include "Poco/Timestamp.h"
+#include "Poco/InflatingStream.h"
+#include "Poco/MemoryStream.h"
+#include "Poco/URI.h"
 
 using namespace haystack;
 
+namespace
+{
+    // records the elapsed micros of a scope
+    class ScopeTimer : boost::noncopyable
+    {
+    public:
+        ScopeTimer(Histogram& h) : m_h(h) {}
+        ~ScopeTimer() { m_h.record((uint64_t)m_start.elapsed()); }
+    private:
+        Histogram& m_h;
+        const Poco::Timestamp m_start;
+    };
+
+    // input stream of at most max bytes of src, exceeded() tells if src
+    // had more
+    class LimitedInputStream : public std::istream
+    {
+    public:
+        LimitedInputStream(std::istream& src, size_t max) : std::istream(NULL), m_buf(*src.rdbuf(), max) { rdbuf(&m_buf); }
+        bool exceeded() const { return m_buf.exceeded; }
+
+    private:
+        class Buf : public std::streambuf
+        {
+        public:
+            Buf(std::streambuf& src, size_t max) : exceeded(false), m_src(src), m_left(max) {}
+            bool exceeded;
+
+        protected:
+            int_type underflow()
+            {
+                if (gptr() < egptr())
+                    return traits_type::to_int_type(*gptr());
+
+                if (m_left == 0)
+                {
+                    exceeded = m_src.sgetc() != traits_type::eof();
+                    return traits_type::eof();
+                }
+
+                const std::streamsize n = m_src.sgetn(m_block, (std::streamsize)std::min(m_left, sizeof(m_block)));
+                if (n <= 0)
+                    return traits_type::eof();
+                m_left -= (size_t)n;
+                setg(m_block, m_block, m_block + n);
+                return traits_type::to_int_type(*gptr());
+            }
+
+        private:
+            std::streambuf& m_src;
+            size_t m_left;
+            char m_block[8192];
+        };
+
+        Buf m_buf;
+    };
+
+    // fast error response of a request which was not admitted
+    void send_busy(HTTPServerResponse& res)
+    {
+        static const std::string body = ZincWriter::grid_to_string(*Grid::make_err(std::runtime_error("Server busy, try again later")));
+
+        res.setStatus(Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE);
+        res.set("Retry-After", "1");
+        res.setChunkedTransferEncoding(false);
+        res.setContentLength(body.size());
+        res.sendBuffer(body.data(), body.size());
+    }
+
+    // an entity tag of the If-None-Match list matches etag, weak tags
+    // compare by their opaque part
+    bool etag_matches(const std::string& header, const std::string& etag)
+    {
+        std::string::size_type pos = 0;
+        while (pos < header.size())
+        {
+            std::string::size_type end = header.find(',', pos);
+            if (end == std::string::npos)
+                end = header.size();
+
+            std::string::size_type b = header.find_first_not_of(" \t", pos);
+            std::string::size_type e = header.find_last_not_of(" \t", end - 1);
+            if (b != std::string::npos && b < end && e != std::string::npos && e >= b)
+            {
+                std::string tag = header.substr(b, e - b + 1);
+                if (tag == "*")
+                    return true;
+                if (tag.compare(0, 2, "W/") == 0)
+                    tag.erase(0, 2);
+                if (tag == etag)
+                    return true;
+            }
+            pos = end + 1;
+        }
+        return false;
+    }
+}
+
 // Service the request and return response.
 // This method routes to "on_service(const Server& db, HTTPServerRequest& req, HTTPServerResponse& res)".
 void Op::on_service(Server& db, HTTPServerRequest& req, HTTPServerResponse& res)
 {
+    m_metrics.requests.add();
+    ScopeTimer total(m_metrics.total);
+    HAYSTACK_TRACE_SPAN(span, "Op::on_service");
+    HAYSTACK_TRACE_DETAIL(span, name());
+
     // parse GET query parameters or POST body into grid
     Grid::auto_ptr_t reqGrid;
     const std::string& method = req.getMethod();
-    if (method == "GET")
     {
-        reqGrid = get_to_grid(req);
+        ScopeTimer parse(m_metrics.parse);
+        if (method == "GET")
+        {
+            reqGrid = get_to_grid(req);
+        }
+        else if (method == "POST")
+        {
+            reqGrid = post_to_grid(req, res);
+            if (reqGrid.get() == NULL)
+                return;
+        }
+        else
+        {
+            // unhandeld request type
+            return;
+        }
     }
-    else if (method == "POST")
+    const Grid& r = reqGrid.get() != NULL ? *reqGrid : Grid::EMPTY;
+
+    res.setContentType("text/zinc; charset=utf-8");
+
+    // negotiate the content encoding
+    ResponseStream::Encoding enc = ResponseStream::IDENTITY;
+    const int level = db.compression_level();
+    if (level > 0)
+    {
+        enc = ResponseStream::negotiate(req.get("Accept-Encoding", ""));
+        res.set("Vary", "Accept-Encoding");
+    }
+
+    // idempotent ops are served from the response cache
+    // read the version first, a change while encoding must not be cached
+    // as current, nothing is cached for a database of unknown version
+    const long ttl = cache_ttl(r);
+    const uint64_t version = ttl != NO_CACHE ? db.version() : Server::UNKNOWN_VERSION;
+    if (version != Server::UNKNOWN_VERSION)
     {
-        reqGrid = post_to_grid(req, res);
-        if (reqGrid.get() == NULL)
+        const std::string key = name() + "\n" + ResponseStream::name(enc) + "\n" + ZincWriter::grid_to_string(r);
+
+        ResponseCache::entry_ptr e = db.response_cache().find(key, version, ttl);
+        if (e.get() != NULL)
+        {
+            m_metrics.cache_hits.add();
+            HAYSTACK_TRACE_ARG(span, "cacheHit", 1);
+        }
+        else
+        {
+            Admission::Scope admit(db.admission(), name(), priority());
+            if (!admit.admitted())
+            {
+                m_metrics.rejected.add();
+                send_busy(res);
+                return;
+            }
+
+            // bodies too large to cache are streamed as they are written
+            res.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+            ResponseStream os(res, enc, level, db.compression_threshold(), MAX_CACHED_BODY);
+            const bool ok = write_response(db, r, os);
+            if (!ok || !os.held())
+            {
+                os.close();
+                m_metrics.bytes_out.add(os.sent());
+                HAYSTACK_TRACE_ARG(span, "bytesOut", os.sent());
+                return;
+            }
+
+            std::string body = os.take();
+            const ResponseStream::Encoding used = body.size() > db.compression_threshold() ? enc : ResponseStream::IDENTITY;
+            if (used != ResponseStream::IDENTITY)
+                body = ResponseStream::encode(body, used, level);
+
+            e = db.response_cache().put(key, version, body, ResponseStream::name(used));
+        }
+
+        res.set("ETag", e->etag);
+        res.setChunkedTransferEncoding(false);
+        if (etag_matches(req.get("If-None-Match", ""), e->etag))
+        {
+            res.setStatus(Poco::Net::HTTPResponse::HTTP_NOT_MODIFIED);
+            res.setContentLength(0);
+            res.send();
             return;
+        }
+
+        if (!e->encoding.empty())
+            res.set("Content-Encoding", e->encoding);
+        res.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+        res.setContentLength(e->body.size());
+        res.sendBuffer(e->body.data(), e->body.size());
+        m_metrics.bytes_out.add(e->body.size());
+        return;
     }
-    else
+
+    Admission::Scope admit(db.admission(), name(), priority());
+    if (!admit.admitted())
     {
-        // unhandeld request type
+        m_metrics.rejected.add();
+        send_busy(res);
         return;
     }
-    // send response
+
+    // send response, compressed as it is written once past the threshold
     res.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
-    res.setContentType("text/zinc; charset=utf-8");
+    ResponseStream os(res, enc, level, db.compression_threshold());
+    write_response(db, r, os);
+    os.close();
+    m_metrics.bytes_out.add(os.sent());
+    HAYSTACK_TRACE_ARG(span, "bytesOut", os.sent());
+}
 
-    std::ostream& ostr = res.send();
-    ZincWriter w(ostr);
+bool Op::write_response(Server& db, const Grid& req, std::ostream& os)
+{
+    ZincWriter w(os);
 
     // route to on_service(Server& db, const Grid& req)
     try
     {
         Grid::auto_ptr_t g;
+        {
+            ScopeTimer execute(m_metrics.execute);
+            g = on_service(db, req);
+        }
 
-        if (reqGrid.get() != NULL)
-            g = on_service(db, *reqGrid);
-        else
-            g = on_service(db, Grid::EMPTY);
-
+        ScopeTimer encode(m_metrics.encode);
         if (g.get() != NULL)
+        {
+            m_metrics.rows.add(g->num_rows());
             w.write_grid(*g);
+        }
         else
             w.write_grid(Grid::EMPTY);
     }
     catch (std::runtime_error& e)
     {
+        m_metrics.errors.add();
         w.write_grid(*Grid::make_err(e));
+        return false;
     }
+    return true;
 }
 
 // Service the request and return response.
@@ -112,28 +324,58 @@ Val::auto_ptr_t Op::val_to_id(const Server& db, const Val& val) const
     }
 }
 
+long Op::timeout_millis(const Dict& meta, long max)
+{
+    const Val& timeout = meta.get("timeout", false);
+    if (timeout.type() != Val::NUM_TYPE)
+        return -1;
+
+    const Num& t = timeout.as<Num>();
+    const double millis = t.unit == "ms" ? t.value : t.value * 1000;
+    return (long)std::max(0.0, std::min(millis, (double)max));
+}
+
 // Map the GET query parameters to grid with one row
 Grid::auto_ptr_t  Op::get_to_grid(HTTPServerRequest& req)
 {
-    using namespace Poco::Net;
-    HTMLForm form(req);
-
-    if (form.empty())
+    // split the raw query in place rather than through HTMLForm
+    const std::string& uri = req.getURI();
+    size_t pos = uri.find('?');
+    if (pos == uri.npos)
         return Grid::auto_ptr_t();
-
-    NameValueCollection::ConstIterator it = form.begin();
-    NameValueCollection::ConstIterator end = form.end();
+    const size_t end = std::min(uri.find('#', pos), uri.size());
 
     Dict d;
+    std::string name;
+    std::string val_str;
 
-    for (; it != end; ++it)
+    while (pos < end)
     {
-        const std::string& name = it->first;
-        const std::string& val_str = it->second;
+        const size_t start = pos + 1;
+        size_t amp = uri.find('&', start);
+        if (amp == uri.npos || amp > end)
+            amp = end;
+        pos = amp;
+
+        if (amp == start)
+            continue;
+
+        size_t eq = uri.find('=', start);
+        if (eq == uri.npos || eq > amp)
+            eq = amp;
+
+        name.clear();
+        val_str.clear();
+        Poco::URI::decode(uri.substr(start, eq - start), name, true);
+        if (eq < amp)
+            Poco::URI::decode(uri.substr(eq + 1, amp - eq - 1), val_str, true);
+
+        // parse from memory, no stream allocation per parameter
         Val::auto_ptr_t val;
         try
         {
-            val = ZincReader::make(val_str)->read_scalar();
+            Poco::MemoryInputStream in(val_str.data(), val_str.size());
+            val = ZincReader(in).read_scalar();
         }
         catch (std::exception&)
         {
@@ -143,6 +385,9 @@ Grid::auto_ptr_t  Op::get_to_grid(HTTPServerRequest& req)
         d.add(name, val);
     }
 
+    if (d.is_empty())
+        return Grid::auto_ptr_t();
+
     return Grid::make(d);
 }
 
@@ -157,7 +402,55 @@ Grid::auto_ptr_t Op::post_to_grid(HTTPServerRequest& req, HTTPServerResponse& re
         return Grid::auto_ptr_t();
     }
 
-    return ZincReader(req.stream()).read_grid();
+    const std::string& encoding = req.get("Content-Encoding", "");
+    const bool identity = encoding.empty() || encoding == "identity";
+    if (!identity && encoding != "gzip" && encoding != "x-gzip" && encoding != "deflate")
+    {
+        res.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_UNSUPPORTEDMEDIATYPE, encoding);
+        res.send();
+        return Grid::auto_ptr_t();
+    }
+
+    // read the body in large blocks and parse it from memory
+    BodyBuffer body;
+    const bool read = body.read(req.stream(), req.hasContentLength() ? req.getContentLength() : -1, MAX_BODY);
+    m_metrics.bytes_in.add(body.size());
+    if (!read)
+    {
+        res.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_REQUESTENTITYTOOLARGE);
+        res.send();
+        return Grid::auto_ptr_t();
+    }
+    Poco::MemoryInputStream in(body.data(), body.size());
+
+    if (identity)
+        return ZincReader(in).read_grid();
+
+    // compressed request body, inflated to at most MAX_BODY bytes
+    Poco::InflatingInputStream inflated(in,
+        encoding == "deflate" ? Poco::InflatingStreamBuf::STREAM_ZLIB : Poco::InflatingStreamBuf::STREAM_GZIP);
+    LimitedInputStream limited(inflated, MAX_BODY);
+
+    Grid::auto_ptr_t g;
+    try
+    {
+        g = ZincReader(limited).read_grid();
+    }
+    catch (std::exception&)
+    {
+        // a body cut at the limit fails to parse
+        if (!limited.exceeded())
+            throw;
+    }
+
+    // the reader wanted more than MAX_BODY inflated bytes
+    if (limited.exceeded())
+    {
+        res.setStatusAndReason(Poco::Net::HTTPResponse::HTTP_REQUESTENTITYTOOLARGE);
+        res.send();
+        return Grid::auto_ptr_t();
+    }
+    return g;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -169,6 +462,8 @@ public:
     AboutOp() {}
     const std::string name() const { return "about"; }
     const std::string summary() const { return "Summary information for server"; }
+    // serverTime is refreshed every second
+    long cache_ttl() const { return 1000; }
 
     Grid::auto_ptr_t on_service(Server& db, const Grid& req)
     {
@@ -184,6 +479,7 @@ class OpsOp : public Op
 public:
     const std::string name() const { return "ops"; }
     const std::string summary() const { return "Operations supported by this server"; }
+    long cache_ttl() const { return CACHE_FOREVER; }
 
     Grid::auto_ptr_t on_service(Server& db, const Grid& req)
     {
@@ -227,6 +523,7 @@ public:
     FormatsOp() {}
     const std::string name() const { return "formats"; }
     const std::string summary() const { return "Grid data formats supported by this server"; }
+    long cache_ttl() const { return CACHE_FOREVER; }
 
     Grid::auto_ptr_t on_service(Server& db, const Grid& req)
     {
@@ -268,6 +565,13 @@ public:
     ReadOp() {}
     const std::string name() const { return "read"; }
     const std::string summary() const { return "Read entity records in database"; }
+    long cache_ttl() const { return CACHE_FOREVER; }
+    // an explained read reports the counts of its own run
+    long cache_ttl(const Grid& req) const
+    {
+        return !req.is_empty() && req.row(0).has("explain") ? NO_CACHE : cache_ttl();
+    }
+    Admission::Priority priority() const { return Admission::LOW; }
 
     Grid::auto_ptr_t on_service(Server& db, const Grid& req)
     {
@@ -283,6 +587,9 @@ public:
             // filter read
             const std::string& filter = row.get_string("filter");
             size_t limit = static_cast<size_t>(row.has("limit") ? row.get_double("limit") : (size_t)-1);
+            // the plan of the read instead of the records
+            if (row.has("explain"))
+                return db.explain(filter, limit);
             return db.read_all(filter, limit);
         }
         else if (row.has("id"))
@@ -312,6 +619,7 @@ public:
     NavOp() {}
     const std::string name() const { return "nav"; }
     const std::string summary() const { return "Navigate record tree"; }
+    long cache_ttl() const { return CACHE_FOREVER; }
 
     Grid::auto_ptr_t on_service(Server& db, const Grid& req)
     {
@@ -338,6 +646,7 @@ public:
     WatchSubOp() {}
     const std::string name() const { return "watchSub"; }
     const std::string summary() const { return "Watch subscription"; }
+    Admission::Priority priority() const { return Admission::HIGH; }
 
     Grid::auto_ptr_t on_service(Server& db, const Grid& req)
     {
@@ -375,6 +684,7 @@ public:
     WatchUnsubOp() {}
     const std::string name() const { return "watchUnsub"; }
     const std::string summary() const { return "Watch unsubscription"; }
+    Admission::Priority priority() const { return Admission::HIGH; }
 
     Grid::auto_ptr_t on_service(Server& db, const Grid& req)
     {
@@ -402,9 +712,13 @@ public:
 class WatchPollOp : public Op
 {
 public:
+    // longest a watchPoll may wait for changes, millis
+    enum { MAX_POLL_TIMEOUT = 60 * 1000 };
+
     WatchPollOp() {}
     const std::string name() const { return "watchPoll"; }
     const std::string summary() const { return "Watch poll cov or refresh"; }
+    Admission::Priority priority() const { return Admission::HIGH; }
 
     Grid::auto_ptr_t on_service(Server& db, const Grid& req)
     {
@@ -418,8 +732,13 @@ public:
             // poll cov or refresh
             if (req.meta().has("refresh"))
                 return watch->poll_refresh();
-            else
-                return watch->poll_changes();
+
+            // long poll, wait up to timeout for a change
+            const long timeout = timeout_millis(req.meta(), MAX_POLL_TIMEOUT);
+            if (timeout >= 0)
+                return watch->poll_changes(timeout);
+
+            return watch->poll_changes();
         }
         Grid::auto_ptr_t g = Grid::make_err(std::runtime_error("Watch not found. " + watchId));
         g->meta().add("watchId", watchId);
@@ -427,6 +746,119 @@ public:
     }
 };
 
+//////////////////////////////////////////////////////////////////////////
+// WatchStreamOp
+//////////////////////////////////////////////////////////////////////////
+class WatchStreamOp : public Op
+{
+public:
+    // max open streams, each holds a worker thread, apart from the
+    // parked watchPoll budget
+    enum { MAX_STREAMS = 8 };
+    // keep-alive comment interval when nothing changes, millis
+    enum { HEARTBEAT = 15 * 1000 };
+
+    WatchStreamOp() {}
+    const std::string name() const { return "watchStream"; }
+    const std::string summary() const { return "Stream watch changes as server-sent events"; }
+
+    // Push the changes of an open watch as "text/event-stream" until the
+    // client disconnects or the watch is closed. Each event carries a zinc
+    // grid with the latest value of every record changed since the previous
+    // event, so a slow client gets coalesced values, never a backlog.
+    void on_service(Server& db, HTTPServerRequest& req, HTTPServerResponse& res)
+    {
+        Grid::auto_ptr_t reqGrid;
+        if (req.getMethod() == "POST")
+        {
+            reqGrid = post_to_grid(req, res);
+            if (reqGrid.get() == NULL)
+                return;
+        }
+        else
+        {
+            reqGrid = get_to_grid(req);
+        }
+
+        std::string watchId;
+        if (reqGrid.get() != NULL)
+        {
+            if (reqGrid->meta().has("watchId"))
+                watchId = reqGrid->meta().get_str("watchId");
+            else if (!reqGrid->is_empty() && reqGrid->row(0).has("watchId"))
+                watchId = reqGrid->row(0).get_str("watchId");
+        }
+
+        Watch::shared_ptr watch = db.watch(watchId, false);
+        if (watch.get() == NULL)
+        {
+            send_error(res, Poco::Net::HTTPResponse::HTTP_NOT_FOUND, "Watch not found. " + watchId);
+            return;
+        }
+
+        // count and check in one step, two streams must not both take the last slot
+        if (++m_streams > MAX_STREAMS)
+        {
+            --m_streams;
+            send_error(res, Poco::Net::HTTPResponse::HTTP_SERVICE_UNAVAILABLE, "Too many watch streams");
+            return;
+        }
+
+        res.setStatus(Poco::Net::HTTPResponse::HTTP_OK);
+        res.setContentType("text/event-stream; charset=utf-8");
+        res.set("Cache-Control", "no-cache");
+        std::ostream& ostr = res.send();
+
+        try
+        {
+            while (watch->is_open() && ostr.good())
+            {
+                Poco::Timestamp start;
+                Grid::auto_ptr_t g = watch->stream_changes(HEARTBEAT);
+
+                if (g->num_rows() > 0)
+                {
+                    write_event(ostr, *g);
+                }
+                else
+                {
+                    ostr << ": keep-alive\n\n";
+                    // the poll could not wait, do not spin
+                    if (start.elapsed() < 1000 * 1000)
+                        Poco::Thread::sleep(1000);
+                }
+                ostr.flush();
+            }
+        }
+        catch (std::exception&)
+        {
+            // client went away
+        }
+        --m_streams;
+    }
+
+private:
+    static void send_error(HTTPServerResponse& res, Poco::Net::HTTPResponse::HTTPStatus status, const std::string& msg)
+    {
+        res.setStatus(status);
+        res.setContentType("text/zinc; charset=utf-8");
+        ZincWriter(res.send()).write_grid(*Grid::make_err(std::runtime_error(msg)));
+    }
+
+    static void write_event(std::ostream& ostr, const Grid& g)
+    {
+        std::istringstream lines(ZincWriter::grid_to_string(g));
+        std::string line;
+
+        ostr << "event: changes\n";
+        while (std::getline(lines, line))
+            ostr << "data: " << line << "\n";
+        ostr << "\n";
+    }
+
+    Poco::AtomicCounter m_streams;
+};
+
 //////////////////////////////////////////////////////////////////////////
 // List all watches op
 //////////////////////////////////////////////////////////////////////////
@@ -467,11 +899,17 @@ public:
     PointWriteOp() {}
     const std::string name() const { return "pointWrite"; }
     const std::string summary() const { return "Read/write writable point priority array"; }
+    Admission::Priority priority() const { return Admission::HIGH; }
 
     Grid::auto_ptr_t on_service(Server& db, const Grid& req)
     {
         // get required point id
         if (req.is_empty()) throw std::runtime_error("Request has no rows");
+
+        // batch of commands, one per row
+        if (req.num_rows() > 1)
+            return db.point_write(req);
+
         const Row& row = req.row(0);
         Val::auto_ptr_t id = val_to_id(db, row.get("id"));
 
@@ -498,14 +936,35 @@ public:
     HisReadOp() {}
     const std::string name() const { return "hisRead"; }
     const std::string summary() const { return "Read time series from historian"; }
+    Admission::Priority priority() const { return Admission::LOW; }
 
     Grid::auto_ptr_t on_service(Server& db, const Grid& req)
     {
         if (req.is_empty()) throw std::runtime_error("Request has no rows");
+
+        // batch read: one id per row, range in grid meta or first row
+        if (req.num_rows() > 1 || req.meta().has("range"))
+        {
+            const std::string& r = req.meta().has("range") ? req.meta().get_str("range") : req.row(0).get_str("range");
+            return db.his_read(grid_to_ids(db, req), r);
+        }
+
         const Row& row = req.row(0);
         Val::auto_ptr_t id = val_to_id(db, row.get("id"));
 
         const std::string& r = row.get_str("range");
+
+        // optional server side rollup
+        if (row.has("interval") || row.has("rollup"))
+        {
+            const Val& interval = row.get("interval", false);
+            if (interval.type() != Val::NUM_TYPE)
+                throw std::runtime_error("hisRead rollup requires a Number 'interval'");
+
+            const std::string rollup = row.has("rollup") ? row.get_str("rollup") : "avg";
+            return db.his_read((Ref&)*id, r, interval.as<Num>(), rollup);
+        }
+
         return db.his_read((Ref&)*id, r);
     }
 };
@@ -519,14 +978,21 @@ public:
     HisWriteOp() {}
     const std::string name() const { return "hisWrite"; }
     const std::string summary() const { return "Write time series data to historian"; }
+    Admission::Priority priority() const { return Admission::LOW; }
 
     Grid::auto_ptr_t on_service(Server& db, const Grid& req)
     {
         if (req.is_empty()) throw std::runtime_error("Request has no rows");
-        Val::auto_ptr_t id = val_to_id(db, req.meta().get("id"));
 
-        std::vector<HisItem> items = HisItem::grid_to_items(req);
-        db.his_write(id->as<Ref>(), items);
+        // multi-point write, ids in an "id" column or in column meta
+        if (req.meta().missing("id"))
+        {
+            db.his_write(req);
+            return Grid::auto_ptr_t();
+        }
+
+        Val::auto_ptr_t id = val_to_id(db, req.meta().get("id"));
+        db.his_write(id->as<Ref>(), req);
 
         return Grid::auto_ptr_t();
     }
@@ -538,6 +1004,9 @@ public:
 class InvokeActionOp : public Op
 {
 public:
+    // longest an invokeAction may wait for the action, millis
+    enum { MAX_ACTION_TIMEOUT = 60 * 1000 };
+
     InvokeActionOp() {}
     const std::string name() const { return "invokeAction"; }
     const std::string summary() const { return "Invoke action on target entity"; }
@@ -548,10 +1017,220 @@ public:
 
         const std::string& action = req.meta().get_str("action");
 
+        // actions run on the action queue, without a timeout wait until done
+        const long timeout = timeout_millis(req.meta(), MAX_ACTION_TIMEOUT);
+
         if (req.num_rows() > 0)
-            return db.invoke_action(id->as<Ref>(), action, req.row(0));
+            return db.invoke_action(id->as<Ref>(), action, req.row(0), timeout);
         else
-            return db.invoke_action(id->as<Ref>(), action, Dict::EMPTY);
+            return db.invoke_action(id->as<Ref>(), action, Dict::EMPTY, timeout);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////
+// JobStatusOp
+//////////////////////////////////////////////////////////////////////////
+class JobStatusOp : public Op
+{
+public:
+    // longest a jobStatus may wait for the action, millis
+    enum { MAX_JOB_TIMEOUT = 60 * 1000 };
+
+    JobStatusOp() {}
+    const std::string name() const { return "jobStatus"; }
+    const std::string summary() const { return "Status and result of a queued action"; }
+
+    Grid::auto_ptr_t on_service(Server& db, const Grid& req)
+    {
+        const std::string& job = req.meta().has("job") || req.is_empty() ? req.meta().get_str("job") : req.row(0).get_str("job");
+
+        // without a timeout report the current status
+        const long timeout = timeout_millis(req.meta(), MAX_JOB_TIMEOUT);
+        return db.job_status(job, timeout < 0 ? 0 : timeout);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////
+// MetricsOp
+//////////////////////////////////////////////////////////////////////////
+class MetricsOp : public Op
+{
+public:
+    MetricsOp() {}
+    const std::string name() const { return "metrics"; }
+    const std::string summary() const { return "Request counters and latency percentiles per op"; }
+    Admission::Priority priority() const { return Admission::HIGH; }
+
+    Grid::auto_ptr_t on_service(Server& db, const Grid& req)
+    {
+        static const char* const phases[] = { "parse", "execute", "encode", "total" };
+        static const char* const stats[] = { "P50", "P90", "P99", "Max" };
+        static const double quantiles[] = { 0.5, 0.9, 0.99 };
+
+        Grid::auto_ptr_t g(new Grid);
+        // history writes queued and failed appends
+        g->meta().add("hisPending", (double)db.his_ingest().pending())
+            .add("hisFailed", (double)db.his_ingest().failed());
+        g->add_col("op");
+        g->add_col("requests");
+        g->add_col("errors");
+        g->add_col("cacheHits");
+        g->add_col("rejected");
+        g->add_col("bytesIn");
+        g->add_col("bytesOut");
+        g->add_col("rows");
+        for (size_t p = 0; p < 4; ++p)
+            for (size_t i = 0; i < 4; ++i)
+                g->add_col(std::string(phases[p]) + stats[i]);
+
+        const StdOps::ops_map_t& ops = StdOps::ops_map();
+        g->reserve_rows(ops.size());
+
+        Val* v[8 + 4 * 4];
+        for (StdOps::ops_map_t::const_iterator it = ops.begin(), e = ops.end(); it != e; ++it)
+        {
+            const OpMetrics& m = it->second->metrics();
+            const Histogram* h[] = { &m.parse, &m.execute, &m.encode, &m.total };
+
+            size_t c = 0;
+            v[c++] = new Str(it->first);
+            v[c++] = new Num((double)m.requests.value());
+            v[c++] = new Num((double)m.errors.value());
+            v[c++] = new Num((double)m.cache_hits.value());
+            v[c++] = new Num((double)m.rejected.value());
+            v[c++] = new Num((double)m.bytes_in.value());
+            v[c++] = new Num((double)m.bytes_out.value());
+            v[c++] = new Num((double)m.rows.value());
+            for (size_t p = 0; p < 4; ++p)
+            {
+                for (size_t i = 0; i < 3; ++i)
+                    v[c++] = new Num(h[p]->percentile(quantiles[i]) / 1000.0, "ms");
+                v[c++] = new Num(h[p]->max() / 1000.0, "ms");
+            }
+            g->add_row(v, c);
+        }
+
+        return g;
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////
+// TraceOp
+//////////////////////////////////////////////////////////////////////////
+class TraceOp : public Op
+{
+public:
+    TraceOp() {}
+    const std::string name() const { return "trace"; }
+    const std::string summary() const { return "Recent trace spans of the hot paths"; }
+    Admission::Priority priority() const { return Admission::HIGH; }
+
+    Grid::auto_ptr_t on_service(Server& db, const Grid& req)
+    {
+        // optional span name, minimum duration in ms and newest count
+        std::string span;
+        double min_dur = 0;
+        size_t limit = (size_t)-1;
+        if (!req.is_empty())
+        {
+            const Row& row = req.row(0);
+            if (row.has("span"))
+                span = row.get_string("span");
+            if (row.has("minDur"))
+                min_dur = row.get_double("minDur") * 1000;
+            if (row.has("limit"))
+                limit = static_cast<size_t>(row.get_double("limit"));
+        }
+
+        std::vector<Trace::Event> all;
+        Trace::snapshot(all);
+
+        std::vector<const Trace::Event*> events;
+        for (std::vector<Trace::Event>::const_reverse_iterator it = all.rbegin(), e = all.rend(); it != e && events.size() < limit; ++it)
+        {
+            if (it->duration < min_dur || (!span.empty() && span != it->name))
+                continue;
+            events.push_back(&*it);
+        }
+
+        Grid::auto_ptr_t g(new Grid);
+        g->add_col("name");
+        g->add_col("detail");
+        g->add_col("thread");
+        g->add_col("start");
+        g->add_col("dur");
+        std::map<std::string, size_t> args;
+        for (size_t i = 0; i < events.size(); ++i)
+            for (size_t a = 0; a < events[i]->num_args; ++a)
+                args.insert(std::make_pair(std::string(events[i]->arg_names[a]), (size_t)0));
+        for (std::map<std::string, size_t>::iterator it = args.begin(), e = args.end(); it != e; ++it)
+        {
+            it->second = g->num_cols();
+            g->add_col(it->first);
+        }
+
+        // oldest first, empty cells for the args a span does not have
+        g->reserve_rows(events.size());
+        std::vector<Val*> v(g->num_cols());
+        for (std::vector<const Trace::Event*>::const_reverse_iterator it = events.rbegin(), e = events.rend(); it != e; ++it)
+        {
+            const Trace::Event& ev = **it;
+            std::fill(v.begin(), v.end(), (Val*)NULL);
+            v[0] = new Str(ev.name);
+            if (ev.detail[0] != '\0')
+                v[1] = new Str(ev.detail);
+            v[2] = new Num((double)ev.thread);
+            v[3] = new Num(ev.start / 1000.0, "ms");
+            v[4] = new Num(ev.duration / 1000.0, "ms");
+            for (size_t a = 0; a < ev.num_args; ++a)
+                v[args[ev.arg_names[a]]] = new Num((double)ev.arg_values[a]);
+            g->add_row(&v[0], v.size());
+        }
+
+        return g;
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////
+// SlowQueriesOp
+//////////////////////////////////////////////////////////////////////////
+class SlowQueriesOp : public Op
+{
+public:
+    SlowQueriesOp() {}
+    const std::string name() const { return "slowQueries"; }
+    const std::string summary() const { return "Recent filter reads slower than the threshold"; }
+    Admission::Priority priority() const { return Admission::HIGH; }
+
+    Grid::auto_ptr_t on_service(Server& db, const Grid& req)
+    {
+        const std::vector<SlowQueryLog::Entry> entries = db.slow_queries().entries();
+
+        Grid::auto_ptr_t g(new Grid);
+        g->meta().add("threshold", (double)db.slow_queries().threshold(), "ms");
+        g->add_col("ts");
+        g->add_col("filter");
+        g->add_col("plan");
+        g->add_col("scanned");
+        g->add_col("matched");
+        g->add_col("refHops");
+        g->add_col("dur");
+
+        g->reserve_rows(entries.size());
+        for (std::vector<SlowQueryLog::Entry>::const_iterator it = entries.begin(), e = entries.end(); it != e; ++it)
+        {
+            Val* v[7] = {
+                (Val*)DateTime::make(it->ts).clone().release(),
+                new Str(it->filter),
+                new Str(it->plan),
+                new Num((double)it->scanned),
+                new Num((double)it->matched),
+                new Num((double)it->hops),
+                new Num(it->micros / 1000.0, "ms") };
+            g->add_row(v, 7);
+        }
+
+        return g;
     }
 };
 
@@ -571,6 +1250,8 @@ const Op& StdOps::watch_unsub = WatchUnsubOp();
 const Op& StdOps::watch_poll = WatchPollOp();
 // List all Watches.
 const Op& StdOps::watch_list = WatchListOp();
+// Stream watch changes.
+const Op& StdOps::watch_stream = WatchStreamOp();
 // Read/write writable point priority array.
 const Op& StdOps::point_write = PointWriteOp();
 // Read time series history data.
@@ -579,6 +1260,14 @@ const Op& StdOps::his_read = HisReadOp();
 const Op& StdOps::his_write = HisWriteOp();
 // Invoke action.
 const Op& StdOps::invoke_action = InvokeActionOp();
+// Status and result of a queued action.
+const Op& StdOps::job_status = JobStatusOp();
+// Request counters and latency percentiles per op.
+const Op& StdOps::metrics = MetricsOp();
+// Recent trace spans of the hot paths.
+const Op& StdOps::trace = TraceOp();
+// Recent filter reads slower than the threshold.
+const Op& StdOps::slow_queries = SlowQueriesOp();
 
 // List the registered operations.
 const Op& StdOps::ops = *new OpsOp();
@@ -598,14 +1287,79 @@ const StdOps::ops_map_t& StdOps::ops_map()
     m_ops_map->insert(std::pair<std::string, const Op* const>(StdOps::watch_unsub.name(), &StdOps::watch_unsub));
     m_ops_map->insert(std::pair<std::string, const Op* const>(StdOps::watch_poll.name(), &StdOps::watch_poll));
     m_ops_map->insert(std::pair<std::string, const Op* const>(StdOps::watch_list.name(), &StdOps::watch_list));
+    m_ops_map->insert(std::pair<std::string, const Op* const>(StdOps::watch_stream.name(), &StdOps::watch_stream));
     m_ops_map->insert(std::pair<std::string, const Op* const>(StdOps::point_write.name(), &StdOps::point_write));
     m_ops_map->insert(std::pair<std::string, const Op* const>(StdOps::his_read.name(), &StdOps::his_read));
     m_ops_map->insert(std::pair<std::string, const Op* const>(StdOps::his_write.name(), &StdOps::his_write));
     m_ops_map->insert(std::pair<std::string, const Op* const>(StdOps::invoke_action.name(), &StdOps::invoke_action));
+    m_ops_map->insert(std::pair<std::string, const Op* const>(StdOps::job_status.name(), &StdOps::job_status));
+    m_ops_map->insert(std::pair<std::string, const Op* const>(StdOps::metrics.name(), &StdOps::metrics));
+    m_ops_map->insert(std::pair<std::string, const Op* const>(StdOps::trace.name(), &StdOps::trace));
+    m_ops_map->insert(std::pair<std::string, const Op* const>(StdOps::slow_queries.name(), &StdOps::slow_queries));
     m_ops_map->insert(std::pair<std::string, const Op* const>(StdOps::ops.name(), &StdOps::ops));
 
+    build_table();
+
     return *m_ops_map;
 }
 
+const Op* StdOps::find(const char* name, size_t len)
+{
+    if (m_table == NULL)
+        ops_map();
+
+    const Slot& s = (*m_table)[hash(name, len, m_seed) & (m_table->size() - 1)];
+    if (s.op == NULL || s.name.size() != len || s.name.compare(0, len, name, len) != 0)
+        return NULL;
+    return s.op;
+}
+
+uint32_t StdOps::hash(const char* name, size_t len, uint32_t seed)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; ++i)
+    {
+        h ^= (unsigned char)name[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void StdOps::build_table()
+{
+    // search a seed without collisions, grow the table if there is none
+    for (size_t size = 16; ; size <<= 1)
+    {
+        while (size < m_ops_map->size() * 2)
+            size <<= 1;
+
+        for (uint32_t seed = 0; seed < 4096; ++seed)
+        {
+            std::vector<Slot> table(size);
+            bool ok = true;
+            for (ops_map_t::const_iterator it = m_ops_map->begin(), e = m_ops_map->end(); ok && it != e; ++it)
+            {
+                Slot& s = table[hash(it->first.data(), it->first.size(), seed) & (size - 1)];
+                if (s.op != NULL)
+                {
+                    ok = false;
+                    break;
+                }
+                s.name = it->first;
+                s.op = it->second;
+            }
+
+            if (ok)
+            {
+                m_table = new std::vector<Slot>(table);
+                m_seed = seed;
+                return;
+            }
+        }
+    }
+}
 
 StdOps::ops_map_t* StdOps::m_ops_map = NULL;
+std::vector<StdOps::Slot>* StdOps::m_table = NULL;
+uint32_t StdOps::m_seed = 0;
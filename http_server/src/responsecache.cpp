@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "responsecache.hpp"
+#include <boost/functional/hash.hpp>
+#include <stdio.h>
+
+////////////////////////////////////////////////
+// ResponseCache
+////////////////////////////////////////////////
+using namespace haystack;
+
+ResponseCache::entry_ptr ResponseCache::find(const std::string& key, uint64_t version, long ttl) const
+{
+    Poco::FastMutex::ScopedLock l(m_mutex);
+
+    slots_t::iterator it = m_slots.find(key);
+    if (it == m_slots.end())
+        return entry_ptr();
+
+    Slot& s = it->second;
+    if (s.version != version || (ttl >= 0 && s.created.isElapsed((Poco::Timestamp::TimeDiff)ttl * 1000)))
+    {
+        erase(it);
+        return entry_ptr();
+    }
+
+    m_lru.splice(m_lru.begin(), m_lru, s.lru);
+    return s.entry;
+}
+
+ResponseCache::entry_ptr ResponseCache::put(const std::string& key, uint64_t version, const std::string& body, const std::string& encoding)
+{
+    boost::shared_ptr<Entry> e(new Entry);
+    e->body = body;
+    e->encoding = encoding;
+
+    // strong validator of the body, stays valid across versions which
+    // encode the same body
+    char etag[64];
+    snprintf(etag, sizeof(etag), "\"%lx-%lx\"", (unsigned long)body.size(), (unsigned long)boost::hash_value(body));
+    e->etag = etag;
+
+    // the key is held too, it embeds the request grid
+    const size_t bytes = key.size() + body.size();
+
+    // too large to keep
+    if (bytes > m_max_bytes)
+        return e;
+
+    Poco::FastMutex::ScopedLock l(m_mutex);
+
+    slots_t::iterator it = m_slots.find(key);
+    if (it != m_slots.end())
+        erase(it);
+
+    m_lru.push_front(key);
+    Slot& s = m_slots[key];
+    s.entry = e;
+    s.version = version;
+    s.lru = m_lru.begin();
+    s.bytes = bytes;
+    m_bytes += bytes;
+
+    while (m_bytes > m_max_bytes)
+        erase(m_slots.find(m_lru.back()));
+
+    return e;
+}
+
+void ResponseCache::clear()
+{
+    Poco::FastMutex::ScopedLock l(m_mutex);
+    m_slots.clear();
+    m_lru.clear();
+    m_bytes = 0;
+}
+
+size_t ResponseCache::size() const
+{
+    Poco::FastMutex::ScopedLock l(m_mutex);
+    return m_slots.size();
+}
+
+void ResponseCache::erase(slots_t::iterator it) const
+{
+    m_bytes -= it->second.bytes;
+    m_lru.erase(it->second.lru);
+    m_slots.erase(it);
+}
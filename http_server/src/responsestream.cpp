@@ -0,0 +1,235 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "responsestream.hpp"
+#include <Poco/StringTokenizer.h>
+#include <boost/algorithm/string.hpp>
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+using namespace haystack;
+
+namespace
+{
+    Poco::DeflatingStreamBuf::StreamType stream_type(ResponseStream::Encoding enc)
+    {
+        return enc == ResponseStream::GZIP ? Poco::DeflatingStreamBuf::STREAM_GZIP : Poco::DeflatingStreamBuf::STREAM_ZLIB;
+    }
+}
+
+////////////////////////////////////////////////
+// ResponseStream
+////////////////////////////////////////////////
+
+ResponseStream::ResponseStream(Poco::Net::HTTPServerResponse& res, Encoding enc, int level, size_t threshold, size_t hold)
+    : std::ostream(NULL), m_buf(res, enc, level, threshold, hold)
+{
+    rdbuf(&m_buf);
+}
+
+ResponseStream::~ResponseStream()
+{
+    try
+    {
+        m_buf.close();
+    }
+    catch (...)
+    {
+    }
+}
+
+void ResponseStream::close()
+{
+    m_buf.close();
+}
+
+std::string ResponseStream::take()
+{
+    return m_buf.take();
+}
+
+ResponseStream::Encoding ResponseStream::negotiate(const std::string& accept_encoding)
+{
+    bool gzip = false;
+    bool deflate = false;
+
+    Poco::StringTokenizer st(accept_encoding, ",", Poco::StringTokenizer::TOK_IGNORE_EMPTY | Poco::StringTokenizer::TOK_TRIM);
+    for (Poco::StringTokenizer::Iterator it = st.begin(), e = st.end(); it != e; ++it)
+    {
+        std::string coding = *it;
+        std::string q;
+        const size_t semi = coding.find(';');
+        if (semi != coding.npos)
+        {
+            q = boost::trim_copy(coding.substr(semi + 1));
+            coding = boost::trim_copy(coding.substr(0, semi));
+        }
+
+        // an explicit q=0 refuses the coding
+        if (boost::starts_with(q, "q=0") && q.find_first_of("123456789") == q.npos)
+            continue;
+
+        if (boost::iequals(coding, "gzip") || boost::iequals(coding, "x-gzip"))
+            gzip = true;
+        else if (boost::iequals(coding, "deflate"))
+            deflate = true;
+    }
+
+    return gzip ? GZIP : deflate ? DEFLATE : IDENTITY;
+}
+
+const std::string ResponseStream::name(Encoding enc)
+{
+    switch (enc)
+    {
+    case GZIP: return "gzip";
+    case DEFLATE: return "deflate";
+    default: return "";
+    }
+}
+
+std::string ResponseStream::encode(const std::string& body, Encoding enc, int level)
+{
+    if (enc == IDENTITY)
+        return body;
+
+    std::ostringstream os;
+    Poco::DeflatingOutputStream z(os, stream_type(enc), level);
+    z.write(body.data(), body.size());
+    z.close();
+    return os.str();
+}
+
+////////////////////////////////////////////////
+// ResponseStream::Buf
+////////////////////////////////////////////////
+
+ResponseStream::Buf::Buf(Poco::Net::HTTPServerResponse& res, Encoding enc, int level, size_t threshold, size_t hold)
+    : m_res(res),
+    m_enc(enc),
+    m_level(level),
+    m_threshold(threshold),
+    m_hold(std::max(threshold, hold)),
+    m_wire_os(&m_wire),
+    m_out(NULL),
+    m_closed(false)
+{
+}
+
+void ResponseStream::Buf::close()
+{
+    if (m_closed)
+        return;
+
+    // a held body past the threshold is still compressed
+    if (m_out == NULL && m_pending.size() > m_threshold)
+        start();
+    m_closed = true;
+
+    if (m_out == NULL)
+    {
+        // small enough to send as is in one piece
+        m_res.setChunkedTransferEncoding(false);
+        m_res.setContentLength(m_pending.size());
+        m_res.sendBuffer(m_pending.data(), m_pending.size());
+        m_wire.count = m_pending.size();
+        return;
+    }
+
+    if (m_deflate.get() != NULL)
+        m_deflate->close();
+    m_wire_os.flush();
+}
+
+std::string ResponseStream::Buf::take()
+{
+    if (!held())
+        throw std::runtime_error("Response body already sent");
+
+    m_closed = true;
+    std::string body;
+    body.swap(m_pending);
+    return body;
+}
+
+int ResponseStream::Buf::overflow(int c)
+{
+    if (c == traits_type::eof())
+        return traits_type::not_eof(c);
+
+    const char ch = traits_type::to_char_type(c);
+    return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+}
+
+std::streamsize ResponseStream::Buf::xsputn(const char* s, std::streamsize n)
+{
+    if (m_closed)
+        return 0;
+
+    if (m_out == NULL)
+    {
+        m_pending.append(s, (size_t)n);
+        if (m_pending.size() > m_hold)
+            start();
+        return n;
+    }
+
+    m_out->write(s, n);
+    return m_out->good() ? n : 0;
+}
+
+int ResponseStream::Buf::sync()
+{
+    if (m_out != NULL)
+        m_out->flush();
+    return 0;
+}
+
+void ResponseStream::Buf::start()
+{
+    if (m_enc != IDENTITY)
+        m_res.set("Content-Encoding", name(m_enc));
+
+    m_wire.dst = m_res.send().rdbuf();
+    m_out = &m_wire_os;
+    if (m_enc != IDENTITY)
+    {
+        m_deflate.reset(new Poco::DeflatingOutputStream(*m_out, stream_type(m_enc), m_level));
+        m_out = m_deflate.get();
+    }
+
+    m_out->write(m_pending.data(), m_pending.size());
+    std::string().swap(m_pending);
+}
+
+////////////////////////////////////////////////
+// ResponseStream::Buf::Wire
+////////////////////////////////////////////////
+
+int ResponseStream::Buf::Wire::overflow(int c)
+{
+    if (c == traits_type::eof())
+        return traits_type::not_eof(c);
+
+    if (dst->sputc(traits_type::to_char_type(c)) == traits_type::eof())
+        return traits_type::eof();
+    ++count;
+    return c;
+}
+
+std::streamsize ResponseStream::Buf::Wire::xsputn(const char* s, std::streamsize n)
+{
+    const std::streamsize w = dst->sputn(s, n);
+    count += (size_t)w;
+    return w;
+}
+
+int ResponseStream::Buf::Wire::sync()
+{
+    return dst->pubsync();
+}
@@ -9,10 +9,21 @@
 
 #include "server.hpp"
 #include "hisitem.hpp"
+#include "bool.hpp"
+#include "num.hpp"
+#include "str.hpp"
 #include "filter.hpp"
 #include "uri.hpp"
 #include "datetimerange.hpp"
+#include "trace.hpp"
 #include <boost/scoped_ptr.hpp>
+#include <boost/ptr_container/ptr_map.hpp>
+#include <boost/lexical_cast.hpp>
+#include "Poco/ThreadPool.h"
+#include "Poco/Runnable.h"
+#include "Poco/Event.h"
+#include "Poco/Exception.h"
+#include "Poco/Timestamp.h"
 #include <boost/algorithm/string.hpp>
 
 using namespace haystack;
@@ -117,7 +128,7 @@ Grid::auto_ptr_t Server::point_write_array(const Ref& id)
 void Server::point_write(const Ref& id, int level, const Val& val, const std::string& who, const Num& dur)
 {
     // argument checks
-    if (level < 1 || level > 17) throw std::runtime_error("Invalid level 1-17: " + level);
+    if (level < 1 || level > 17) throw std::runtime_error("Invalid level 1-17: " + boost::lexical_cast<std::string>(level));
     if (who.empty()) throw std::runtime_error("who is empty ''");
 
     // lookup entity
@@ -130,24 +141,215 @@ void Server::point_write(const Ref& id, int level, const Val& val, const std::st
     on_point_write(*rec, level, val, who, dur);
 }
 
+Grid::auto_ptr_t Server::point_write(const Grid& req)
+{
+    const size_t n = req.num_rows();
+    boost::ptr_vector<boost::nullable<Dict> > recs(n);
+    std::vector<std::string> errs(n);
+    std::vector<PointWrite> writes;
+    std::vector<size_t> rows;
+    writes.reserve(n);
+    rows.reserve(n);
+
+    // check every row, a bad one only fails itself
+    for (size_t i = 0; i < n; ++i)
+    {
+        const Row& row = req.row(i);
+        recs.push_back(NULL);
+        try
+        {
+            const Val& id = row.get("id");
+            if (id.type() != Val::REF_TYPE)
+                throw std::runtime_error("Invalid id: " + id.to_string());
+
+            PointWrite w;
+            w.level = static_cast<int>(row.get_int("level"));
+            w.who = row.get_str("who");
+            w.val = &row.get("val", false);
+            const Val& dur = row.get("duration", false);
+            w.dur = dur.type() == Val::NUM_TYPE ? &dur.as<Num>() : NULL;
+
+            if (w.level < 1 || w.level > 17) throw std::runtime_error("Invalid level 1-17: " + boost::lexical_cast<std::string>(w.level));
+            if (w.who.empty()) throw std::runtime_error("who is empty ''");
+
+            recs.replace(i, read_by_id(id.as<Ref>()).release());
+            if (recs[i].missing("writable"))
+                throw std::runtime_error("Rec missing 'writable' tag: " + recs[i].dis());
+
+            w.rec = &recs[i];
+            writes.push_back(w);
+            rows.push_back(i);
+        }
+        catch (std::exception& e)
+        {
+            errs[i] = e.what();
+        }
+    }
+
+    // route to subclass
+    on_point_write(writes);
+    for (size_t i = 0; i < writes.size(); ++i)
+        errs[rows[i]] = writes[i].err;
+
+    // status of each row
+    Grid::auto_ptr_t g(new Grid);
+    g->add_col("id");
+    g->add_col("level");
+    g->add_col("status");
+    g->add_col("dis");
+    g->reserve_rows(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const Row& row = req.row(i);
+        const Val& id = row.get("id", false);
+        const Val& level = row.get("level", false);
+        Val* v[4] = {
+            id.is_empty() ? NULL : (Val*)id.clone().release(),
+            level.is_empty() ? NULL : (Val*)level.clone().release(),
+            new Str(errs[i].empty() ? "ok" : "err"),
+            errs[i].empty() ? NULL : new Str(errs[i]),
+        };
+        g->add_row(v, 4);
+    }
+    return g;
+}
+
+void Server::on_point_write(std::vector<PointWrite>& writes)
+{
+    const Num none(0);
+    for (std::vector<PointWrite>::iterator it = writes.begin(), e = writes.end(); it != e; ++it)
+    {
+        try
+        {
+            on_point_write(*it->rec, it->level, *it->val, it->who, it->dur != NULL ? *it->dur : none);
+        }
+        catch (std::exception& ex)
+        {
+            it->err = ex.what();
+        }
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////
 // History
 //////////////////////////////////////////////////////////////////////////
 
 Grid::auto_ptr_t Server::his_read(const Ref& id, const std::string& range)
+{
+    HAYSTACK_TRACE_SPAN(span, "Server::his_read");
+    HAYSTACK_TRACE_DETAIL(span, id.value);
+
+    DateTimeRange::auto_ptr_t r;
+    Dict::auto_ptr_t rec = his_rec(id, range, r);
+
+    // route to subclass
+    std::vector<HisItem> items = on_his_read(*rec, *r);
+    HAYSTACK_TRACE_ARG(span, "items", items.size());
+
+    // check items
+    if (items.size() > 0)
+    {
+        if (r->start().millis() >= items[0].ts->millis()) throw std::runtime_error("start range not met");
+        if (r->end().millis() < items[items.size() - 1].ts->millis()) throw std::runtime_error("end range not met");
+    }
+
+    // build and return result grid
+    Dict meta;
+    meta.add("id", id)
+        .add("hisStart", r->start())
+        .add("hisEnd", r->end());
+    return HisItem::his_items_to_grid(meta, items);
+}
+
+Grid::auto_ptr_t Server::his_read(const Ref& id, const std::string& range, const Num& interval, const std::string& rollup)
+{
+    HAYSTACK_TRACE_SPAN(span, "Server::his_read");
+    HAYSTACK_TRACE_DETAIL(span, id.value);
+
+    const HisRollup::Func func = HisRollup::parse(rollup);
+    const int64_t millis = HisRollup::interval_millis(interval);
+
+    DateTimeRange::auto_ptr_t r;
+    Dict::auto_ptr_t rec = his_rec(id, range, r);
+
+    // route to subclass
+    HisRollup roll(func, millis, r->start().tz_offset);
+    on_his_rollup(*rec, *r, roll);
+    roll.finish();
+    HAYSTACK_TRACE_ARG(span, "buckets", roll.ts().size());
+
+    // build and return result grid
+    Grid::auto_ptr_t g(new Grid);
+    g->meta().add("id", id)
+        .add("hisStart", r->start())
+        .add("hisEnd", r->end())
+        .add("hisInterval", interval)
+        .add("hisRollup", HisRollup::name(func));
+    g->add_col("ts");
+    g->add_col("val");
+
+    const std::string unit = func != HisRollup::COUNT && rec->has("unit") ? rec->get_str("unit") : "";
+    const std::vector<int64_t>& ts = roll.ts();
+    const std::vector<double>& vals = roll.vals();
+    g->reserve_rows(ts.size());
+    for (size_t i = 0; i < ts.size(); ++i)
+    {
+        Val* v[2] = { (Val*)DateTime::make(ts[i], r->start().tz, r->start().tz_offset).clone().release(), new Num(vals[i], unit) };
+        g->add_row(v, 2);
+    }
+    return g;
+}
+
+void Server::on_his_rollup(const Dict& rec, const DateTimeRange& range, HisRollup& rollup)
+{
+    std::vector<HisItem> items = on_his_read(rec, range);
+
+    std::vector<int64_t> ts;
+    std::vector<double> vals;
+    ts.reserve(items.size());
+    vals.reserve(items.size());
+
+    for (std::vector<HisItem>::const_iterator it = items.begin(), e = items.end(); it != e; ++it)
+    {
+        // only Number and Bool values can be rolled up
+        if (it->val->type() == Val::NUM_TYPE)
+            vals.push_back(it->val->as<Num>().value);
+        else if (it->val->type() == Val::BOOL_TYPE)
+            vals.push_back(it->val->as<Bool>().value ? 1.0 : 0.0);
+        else
+            continue;
+        ts.push_back(it->ts->millis());
+    }
+
+    rollup.add(ts, vals);
+}
+
+Dict::auto_ptr_t Server::his_rec(const Ref& id, const std::string& range, DateTimeRange::auto_ptr_t& r) const
 {
     // lookup entity
     Dict::auto_ptr_t rec = read_by_id(id);
+    r = his_range(*rec, range);
+    return rec;
+}
 
+std::auto_ptr<TimeZone> Server::his_tz(const Dict& rec)
+{
     // check that entity has "his" tag
-    if (rec->missing("his"))
-        throw std::runtime_error("Rec missing 'his' tag: " + rec->dis());
+    if (rec.missing("his"))
+        throw std::runtime_error("Rec missing 'his' tag: " + rec.dis());
 
     // lookup "tz" on entity
-    boost::scoped_ptr<TimeZone> tz;
-    if (rec->has("tz")) tz.reset(new TimeZone(rec->get_str("tz"), false));
+    std::auto_ptr<TimeZone> tz;
+    if (rec.has("tz")) tz.reset(new TimeZone(rec.get_str("tz"), false));
     if (tz.get() == NULL)
-        throw std::runtime_error("Rec missing or invalid 'tz' tag: " + rec->dis());
+        throw std::runtime_error("Rec missing or invalid 'tz' tag: " + rec.dis());
+
+    return tz;
+}
+
+DateTimeRange::auto_ptr_t Server::his_range(const Dict& rec, const std::string& range)
+{
+    std::auto_ptr<TimeZone> tz = his_tz(rec);
 
     // check or parse date range
     DateTimeRange::auto_ptr_t r;
@@ -164,38 +366,181 @@ Grid::auto_ptr_t Server::his_read(const Ref& id, const std::string& range)
     if (r->start().tz != *tz)
         throw std::runtime_error("range.tz != rec: " + r->start().tz.name + " != " + tz->name);
 
-    // route to subclass
-    std::vector<HisItem> items = on_his_read(*rec, *r);
+    return r;
+}
 
-    // check items
-    if (items.size() > 0)
+//////////////////////////////////////////////////////////////////////////
+// Batch History
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    // shared by all batch reads, sized for the typical trend chart
+    Poco::ThreadPool& his_pool()
     {
-        if (r->start().millis() >= items[0].ts->millis()) throw std::runtime_error("start range not met");
-        if (r->end().millis() < items[items.size() - 1].ts->millis()) throw std::runtime_error("end range not met");
+        static Poco::ThreadPool pool("hisRead", 2, 8);
+        return pool;
     }
 
-    // build and return result grid
-    Dict meta;
-    meta.add("id", id)
-        .add("hisStart", r->start())
-        .add("hisEnd", r->end());
-    return HisItem::his_items_to_grid(meta, items);
+    // read cursor over the items of one series
+    struct HisCursor
+    {
+        const std::vector<HisItem>* items;
+        size_t pos;
+    };
+}
+
+class Server::HisReadTask : public Poco::Runnable
+{
+public:
+    HisReadTask(Server& server, const Dict& rec, const DateTimeRange& range)
+        : m_server(server), m_rec(rec), m_range(range) {}
+
+    void run()
+    {
+        try
+        {
+            items = m_server.on_his_read(m_rec, m_range);
+
+            if (items.size() > 0)
+            {
+                if (m_range.start().millis() >= items[0].ts->millis()) throw std::runtime_error("start range not met");
+                if (m_range.end().millis() < items[items.size() - 1].ts->millis()) throw std::runtime_error("end range not met");
+            }
+        }
+        catch (std::exception& e)
+        {
+            error = e.what() + std::string(": ") + m_rec.dis();
+        }
+        done.set();
+    }
+
+    std::vector<HisItem> items;
+    std::string error;
+    Poco::Event done;
+
+private:
+    Server& m_server;
+    const Dict& m_rec;
+    const DateTimeRange& m_range;
+};
+
+Grid::auto_ptr_t Server::his_read(const boost::ptr_vector<Ref>& ids, const std::string& range)
+{
+    HAYSTACK_TRACE_SPAN(span, "Server::his_read");
+    HAYSTACK_TRACE_DETAIL(span, range);
+    HAYSTACK_TRACE_ARG(span, "ids", ids.size());
+
+    if (ids.empty())
+        throw std::runtime_error("hisRead requires at least one id");
+
+    // resolve each record once and parse the range once per timezone
+    boost::ptr_vector<Dict> recs(ids.size());
+    boost::ptr_map<std::string, DateTimeRange> ranges;
+    std::vector<const DateTimeRange*> rec_ranges;
+    rec_ranges.reserve(ids.size());
+
+    for (boost::ptr_vector<Ref>::const_iterator it = ids.begin(), e = ids.end(); it != e; ++it)
+    {
+        recs.push_back(read_by_id(*it).release());
+        const Dict& rec = recs.back();
+
+        const std::string tz = rec.has("tz") ? rec.get_str("tz") : "";
+        boost::ptr_map<std::string, DateTimeRange>::iterator r = ranges.find(tz);
+        if (r == ranges.end())
+        {
+            std::string key(tz);
+            r = ranges.insert(key, his_range(rec, range).release()).first;
+        }
+        else if (rec.missing("his"))
+        {
+            throw std::runtime_error("Rec missing 'his' tag: " + rec.dis());
+        }
+        rec_ranges.push_back(r->second);
+    }
+
+    // read series in parallel, the calling thread takes the first one
+    // and any task the pool has no thread for
+    boost::ptr_vector<HisReadTask> tasks(recs.size());
+    for (size_t i = 0; i < recs.size(); ++i)
+        tasks.push_back(new HisReadTask(*this, recs[i], *rec_ranges[i]));
+
+    for (size_t i = 1; i < tasks.size(); ++i)
+    {
+        try
+        {
+            his_pool().start(tasks[i]);
+        }
+        catch (Poco::NoThreadAvailableException&)
+        {
+            tasks[i].run();
+        }
+    }
+    tasks[0].run();
+
+    for (size_t i = 0; i < tasks.size(); ++i)
+        tasks[i].done.wait();
+
+    for (size_t i = 0; i < tasks.size(); ++i)
+        if (!tasks[i].error.empty()) throw std::runtime_error(tasks[i].error);
+
+    // build wide grid, one column per record
+    const DateTimeRange& first = *rec_ranges[0];
+    Grid::auto_ptr_t g(new Grid);
+    g->meta().add("hisStart", first.start())
+        .add("hisEnd", first.end());
+    g->add_col("ts");
+
+    std::vector<HisCursor> cursors(tasks.size());
+    size_t max_rows = 0;
+    for (size_t i = 0; i < tasks.size(); ++i)
+    {
+        g->add_col("v" + boost::lexical_cast<std::string>(i))
+            .add("id", ids[i])
+            .add("dis", recs[i].dis());
+
+        cursors[i].items = &tasks[i].items;
+        cursors[i].pos = 0;
+        max_rows = std::max(max_rows, tasks[i].items.size());
+    }
+    g->reserve_rows(max_rows);
+
+    // merge the sorted series on their timestamps
+    const size_t cols = tasks.size() + 1;
+    std::vector<Val*> row(cols);
+    for (;;)
+    {
+        const HisItem* next = NULL;
+        for (size_t i = 0; i < cursors.size(); ++i)
+        {
+            const HisCursor& c = cursors[i];
+            if (c.pos < c.items->size() && (next == NULL || (*c.items)[c.pos].ts->millis() < next->ts->millis()))
+                next = &(*c.items)[c.pos];
+        }
+        if (next == NULL)
+            break;
+
+        const int64_t ts = next->ts->millis();
+        row[0] = (Val*)next->ts->clone().release();
+        for (size_t i = 0; i < cursors.size(); ++i)
+        {
+            HisCursor& c = cursors[i];
+            if (c.pos < c.items->size() && (*c.items)[c.pos].ts->millis() == ts)
+                row[i + 1] = (Val*)(*c.items)[c.pos++].val->clone().release();
+            else
+                row[i + 1] = NULL;
+        }
+        g->add_row(&row[0], cols);
+    }
+
+    return g;
 }
 
 void Server::his_write(const Ref& id, const std::vector<HisItem>& items)
 {
     // lookup entity
     Dict::auto_ptr_t rec = read_by_id(id);
-
-    // check that entity has "his" tag
-    if (rec->missing("his"))
-        throw std::runtime_error("Entity missing 'his' tag: " + rec->dis());
-
-    // lookup "tz" on entity
-    boost::scoped_ptr<TimeZone> tz;
-    if (rec->has("tz")) tz.reset(new TimeZone(rec->get_str("tz"), false));
-    if (tz.get() == NULL)
-        throw std::runtime_error("Rec missing or invalid 'tz' tag: " + rec->dis());
+    std::auto_ptr<TimeZone> tz = his_tz(*rec);
 
     // check tz of items
     if (items.size() == 0) return;
@@ -210,28 +555,255 @@ void Server::his_write(const Ref& id, const std::vector<HisItem>& items)
     on_his_write(*rec, items);
 }
 
+// checked record of a his_write and its samples
+class Server::HisPoint
+{
+public:
+    HisPoint(Dict::auto_ptr_t r) :
+        rec(r),
+        tz(his_tz(*rec)),
+        is_bool(rec->has("kind") && rec->get_str("kind") == "Bool")
+    {
+    }
+
+    void add(const Val& t, const Val& v)
+    {
+        if (t.type() != Val::DATE_TIME_TYPE)
+            throw std::runtime_error("Invalid his timestamp: " + t.to_string());
+        const DateTime& ts = t.as<DateTime>();
+        if (ts.tz.name != tz->name)
+            throw std::runtime_error("item.tz != rec.tz: " + ts.tz.name + " != " + tz->name);
+        if (v.type() != (is_bool ? Val::BOOL_TYPE : Val::NUM_TYPE))
+            throw std::runtime_error("Invalid his value for " + rec->dis() + ": " + v.to_string());
+
+        const double d = is_bool ? (v.as<Bool>().value ? 1.0 : 0.0) : v.as<Num>().value;
+        samples.push_back(HisChunk::Sample(ts.millis(), d, ts.tz_offset));
+    }
+
+    Dict::auto_ptr_t rec;
+    std::auto_ptr<TimeZone> tz;
+    const bool is_bool;
+    std::vector<HisChunk::Sample> samples;
+};
+
+void Server::his_write(const Ref& id, const Grid& items)
+{
+    HisPoint p(read_by_id(id));
+
+    const Col* ts_col = items.col("ts");
+    const Col* val_col = items.col("val");
+
+    // check and stream the rows into samples, no HisItem copies
+    p.samples.reserve(items.num_rows());
+    for (Grid::const_iterator it = items.begin(), e = items.end(); it != e; ++it)
+        p.add(it->get(*ts_col), it->get(*val_col));
+
+    m_his_ingest.submit(*p.rec, p.samples);
+}
+
+void Server::his_write(const Grid& items)
+{
+    boost::ptr_vector<HisPoint> points;
+    std::map<std::string, size_t> index;
+
+    const Col* ts_col = items.col("ts");
+    const Col* id_col = items.col("id", false);
+
+    if (id_col != NULL)
+    {
+        // long form, one sample per row
+        const Col* val_col = items.col("val");
+        for (Grid::const_iterator it = items.begin(), e = items.end(); it != e; ++it)
+        {
+            const Val& id = it->get(*id_col);
+            if (id.type() != Val::REF_TYPE)
+                throw std::runtime_error("Invalid his id: " + id.to_string());
+
+            std::map<std::string, size_t>::const_iterator i = index.find(id.as<Ref>().value);
+            if (i == index.end())
+            {
+                points.push_back(new HisPoint(read_by_id(id.as<Ref>())));
+                i = index.insert(std::make_pair(id.as<Ref>().value, points.size() - 1)).first;
+            }
+            points[i->second].add(it->get(*ts_col), it->get(*val_col));
+        }
+    }
+    else
+    {
+        // wide form, a column per point tagged with its id, null cells skipped
+        std::vector<const Col*> cols;
+        for (size_t c = 0; c < items.num_cols(); ++c)
+        {
+            const Col& col = items.col(c);
+            if (&col == ts_col)
+                continue;
+            const Val& id = col.meta().get("id", false);
+            if (id.type() != Val::REF_TYPE)
+                throw std::runtime_error("His column missing 'id' meta: " + col.name());
+
+            points.push_back(new HisPoint(read_by_id(id.as<Ref>())));
+            points.back().samples.reserve(items.num_rows());
+            cols.push_back(&col);
+        }
+
+        for (Grid::const_iterator it = items.begin(), e = items.end(); it != e; ++it)
+        {
+            const Val& ts = it->get(*ts_col);
+            for (size_t c = 0; c < cols.size(); ++c)
+            {
+                const Val& v = it->get(*cols[c]);
+                if (!v.is_empty())
+                    points[c].add(ts, v);
+            }
+        }
+    }
+
+    // every point checked, queue all of them together
+    std::vector<const Dict*> recs;
+    std::vector<std::vector<HisChunk::Sample> > samples(points.size());
+    recs.reserve(points.size());
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        recs.push_back(points[i].rec.get());
+        samples[i].swap(points[i].samples);
+    }
+
+    m_his_ingest.submit(recs, samples);
+}
+
+void Server::on_his_append(const Dict& rec, std::vector<HisChunk::Sample>& samples)
+{
+    const bool is_bool = rec.has("kind") && rec.get_str("kind") == "Bool";
+    const std::string unit = rec.has("unit") ? rec.get_str("unit") : "";
+    const TimeZone tz(rec.get_str("tz"), false);
+
+    std::vector<HisItem> items;
+    items.reserve(samples.size());
+    for (std::vector<HisChunk::Sample>::const_iterator it = samples.begin(), e = samples.end(); it != e; ++it)
+    {
+        boost::shared_ptr<const DateTime> ts((DateTime*)DateTime::make(it->ts, tz, it->tz_offset).clone().release());
+        boost::shared_ptr<const Val> val(is_bool ? (Val*)new Bool(it->val != 0.0) : new Num(it->val, unit));
+        items.push_back(HisItem(ts, val));
+    }
+
+    on_his_write(rec, items);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Actions
+//////////////////////////////////////////////////////////////////////////
+
+Grid::auto_ptr_t Server::invoke_action(const Ref& id, const std::string& action, const Dict& args, long timeout)
+{
+    return job_status(m_actions.submit(id, action, args), timeout);
+}
+
+Grid::auto_ptr_t Server::job_status(const std::string& job, long timeout)
+{
+    Grid::auto_ptr_t result;
+    // the status seen by the wait, the job may be retired right after
+    const ActionQueue::Status status = m_actions.wait(job, timeout, result);
+    if (result.get() != NULL)
+        return result;
+
+    // still running or finished without a result
+    Grid::auto_ptr_t g(new Grid);
+    g->meta().add("job", job)
+        .add("jobStatus", ActionQueue::status_name(status));
+    g->add_col("empty");
+    return g;
+}
+
+void Server::stop_workers()
+{
+    m_actions.stop();
+    m_his_ingest.stop();
+}
+
 
 class PathImpl : public Pather
 {
 public:
-    PathImpl(const Server& s) : m_s(s) {}
+    PathImpl(const Server& s) : m_s(s), m_hops(0) {}
     const Dict& find(const std::string& ref) const
     {
         Server& s = const_cast<Server&>(m_s);
         const_cast<PathImpl*>(this)->m_d = s.read_by_id(Ref(ref));
+        ++m_hops;
         return *m_d;
     }
+    // refs followed so far
+    size_t hops() const { return m_hops; }
 private:
     const Server& m_s;
     Dict::auto_ptr_t m_d;
+    mutable size_t m_hops;
 };
 
 Grid::auto_ptr_t Server::on_read_all(const std::string& filter, size_t limit) const
 {
-    Filter::shared_ptr_t f = Filter::make(filter);
-    PathImpl pather(*this);
+    HAYSTACK_TRACE_SPAN(span, "Server::on_read_all");
+    HAYSTACK_TRACE_DETAIL(span, filter);
+    const Poco::Timestamp start;
+
+    // cheap selective operands first
+    Filter::shared_ptr_t f = FilterPlan::optimize(Filter::make(filter), *tag_stats());
+
+    std::vector<const Dict*> v;
+    boost::ptr_vector<Dict> held;
+    size_t scanned = 0;
+    size_t hops = 0;
+    match(*f, NULL, limit, v, held, scanned, hops);
+
+    HAYSTACK_TRACE_ARG(span, "scanned", scanned);
+    HAYSTACK_TRACE_ARG(span, "matched", v.size());
+    m_slow_queries.record(filter, FilterPlan::index_id(*f).empty() ? "scan" : "id index", scanned, v.size(), hops, (uint64_t)start.elapsed());
+    return Grid::make(v);
+}
+
+Grid::auto_ptr_t Server::explain(const std::string& filter, size_t limit) const
+{
+    const Poco::Timestamp start;
+
+    FilterPlan plan(Filter::make(filter), *tag_stats());
 
     std::vector<const Dict*> v;
+    boost::ptr_vector<Dict> held;
+    size_t scanned = 0;
+    size_t hops = 0;
+    match(plan.filter(), &plan, limit, v, held, scanned, hops);
+    const Poco::Timestamp::TimeDiff elapsed = start.elapsed();
+
+    Grid::auto_ptr_t g = plan.to_grid();
+    g->meta().add("scanned", (double)scanned)
+        .add("matched", (double)v.size())
+        .add("refHops", (double)hops)
+        .add("dur", elapsed / 1000.0, "ms");
+    return g;
+}
+
+void Server::match(const Filter& f, FilterPlan* plan, size_t limit, std::vector<const Dict*>& recs,
+    boost::ptr_vector<Dict>& held, size_t& scanned, size_t& hops) const
+{
+    PathImpl pather(*this);
+
+    // a record named by an id conjunct is the only candidate
+    const std::string id = FilterPlan::index_id(f);
+    if (!id.empty())
+    {
+        Dict::auto_ptr_t rec = read_by_id(Ref(id), false);
+        if (rec.get() != NULL && !rec->is_empty())
+        {
+            ++scanned;
+            if (plan != NULL ? plan->include(*rec, pather) : f.include(*rec, pather))
+            {
+                held.push_back(rec.release());
+                recs.push_back(&held.back());
+            }
+        }
+        hops = pather.hops();
+        return;
+    }
 
     for (const_iterator it = begin(), e = end(); it != e; ++it)
     {
@@ -239,15 +811,55 @@ Grid::auto_ptr_t Server::on_read_all(const std::string& filter, size_t limit) co
         if (row.is_empty())
             continue;
 
-        if (f->include(row, pather))
+        ++scanned;
+        if (plan != NULL ? plan->include(row, pather) : f.include(row, pather))
         {
-            v.push_back(&*it);
-            if (v.size() > limit)
+            recs.push_back(&*it);
+            if (recs.size() > limit)
                 break;
         }
     }
+    hops = pather.hops();
+}
 
-    return Grid::make(v);
+boost::shared_ptr<const TagStats> Server::tag_stats() const
+{
+    const uint64_t v = version();
+    boost::shared_ptr<const TagStats> current;
+    {
+        Poco::FastMutex::ScopedLock lock(m_stats_lock);
+        current = m_stats;
+        const bool stale = current.get() == NULL
+            || ((v == UNKNOWN_VERSION || v != m_stats_version) && m_stats_time.isElapsed((Poco::Timestamp::TimeDiff)STATS_MAX_AGE * 1000));
+        // a rebuild under way serves the previous stats
+        if (!stale || (m_stats_building && current.get() != NULL))
+            return current;
+        m_stats_building = true;
+    }
+
+    // scan the records without the lock, readers only copy the pointer
+    boost::shared_ptr<TagStats> stats(new TagStats);
+    try
+    {
+        for (const_iterator it = begin(), e = end(); it != e; ++it)
+        {
+            if (!it->is_empty())
+                stats->add(*it);
+        }
+    }
+    catch (...)
+    {
+        Poco::FastMutex::ScopedLock lock(m_stats_lock);
+        m_stats_building = false;
+        throw;
+    }
+
+    Poco::FastMutex::ScopedLock lock(m_stats_lock);
+    m_stats = stats;
+    m_stats_version = v;
+    m_stats_time.update();
+    m_stats_building = false;
+    return m_stats;
 }
 
 const DateTime& Server::boot_time()
@@ -259,4 +871,5 @@ const DateTime& Server::boot_time()
     return *m_boot_time;
 }
 
-const DateTime* Server::m_boot_time = NULL;
\ No newline at end of file
+const DateTime* Server::m_boot_time = NULL;
+const uint64_t Server::UNKNOWN_VERSION;
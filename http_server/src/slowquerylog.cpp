@@ -0,0 +1,57 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "slowquerylog.hpp"
+#include <Poco/Timestamp.h>
+
+////////////////////////////////////////////////
+// SlowQueryLog
+////////////////////////////////////////////////
+using namespace haystack;
+
+SlowQueryLog::SlowQueryLog(size_t capacity, long threshold)
+    : m_capacity(capacity), m_threshold(threshold)
+{
+}
+
+void SlowQueryLog::configure(size_t capacity, long threshold)
+{
+    Poco::FastMutex::ScopedLock l(m_mutex);
+    m_capacity = capacity;
+    m_threshold = threshold;
+    while (m_entries.size() > m_capacity)
+        m_entries.pop_front();
+}
+
+void SlowQueryLog::record(const std::string& filter, const std::string& plan, size_t scanned, size_t matched, size_t hops, uint64_t micros)
+{
+    const long threshold = m_threshold;
+    if (threshold < 0 || micros < (uint64_t)threshold * 1000)
+        return;
+
+    Entry e;
+    e.ts = Poco::Timestamp().epochMicroseconds() / 1000;
+    e.filter = filter;
+    e.plan = plan;
+    e.scanned = scanned;
+    e.matched = matched;
+    e.hops = hops;
+    e.micros = micros;
+
+    Poco::FastMutex::ScopedLock l(m_mutex);
+    if (m_capacity == 0)
+        return;
+    if (m_entries.size() == m_capacity)
+        m_entries.pop_front();
+    m_entries.push_back(e);
+}
+
+std::vector<SlowQueryLog::Entry> SlowQueryLog::entries() const
+{
+    Poco::FastMutex::ScopedLock l(m_mutex);
+    return std::vector<Entry>(m_entries.rbegin(), m_entries.rend());
+}
@@ -0,0 +1,90 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "subregistry.hpp"
+#include <algorithm>
+
+////////////////////////////////////////////////
+// SubRegistry
+////////////////////////////////////////////////
+using namespace haystack;
+
+void SubRegistry::sub(Subscriber& s, const std::vector<std::string>& ids, std::vector<const Dict*>& recs)
+{
+    recs.reserve(recs.size() + ids.size());
+
+    Poco::FastMutex::ScopedLock l(m_mutex);
+    for (std::vector<std::string>::const_iterator id = ids.begin(), e = ids.end(); id != e; ++id)
+    {
+        entries_t::iterator it = m_entries.find(*id);
+        if (it == m_entries.end())
+        {
+            // first subscriber resolves the record
+            recs_t::const_iterator rec = m_recs.find(*id);
+            if (rec == m_recs.end())
+            {
+                recs.push_back(NULL);
+                continue;
+            }
+            it = m_entries.insert(std::make_pair(*id, Entry())).first;
+            it->second.rec = rec->second;
+        }
+
+        it->second.subs.push_back(&s);
+        recs.push_back(it->second.rec);
+    }
+}
+
+void SubRegistry::unsub(Subscriber& s, const std::vector<std::string>& ids)
+{
+    Poco::FastMutex::ScopedLock l(m_mutex);
+    for (std::vector<std::string>::const_iterator id = ids.begin(), e = ids.end(); id != e; ++id)
+    {
+        entries_t::iterator it = m_entries.find(*id);
+        if (it == m_entries.end())
+            continue;
+
+        std::vector<Subscriber*>& subs = it->second.subs;
+        std::vector<Subscriber*>::iterator pos = std::find(subs.begin(), subs.end(), &s);
+        if (pos == subs.end())
+            continue;
+
+        // order does not matter, swap with the last
+        *pos = subs.back();
+        subs.pop_back();
+
+        if (subs.empty())
+            m_entries.erase(it);
+    }
+}
+
+void SubRegistry::notify(const std::string& id) const
+{
+    Poco::FastMutex::ScopedLock l(m_mutex);
+
+    entries_t::const_iterator it = m_entries.find(id);
+    if (it == m_entries.end())
+        return;
+
+    const std::vector<Subscriber*>& subs = it->second.subs;
+    for (std::vector<Subscriber*>::const_iterator s = subs.begin(), e = subs.end(); s != e; ++s)
+        (*s)->on_change(it->first);
+}
+
+size_t SubRegistry::refs(const std::string& id) const
+{
+    Poco::FastMutex::ScopedLock l(m_mutex);
+
+    entries_t::const_iterator it = m_entries.find(id);
+    return it == m_entries.end() ? 0 : it->second.subs.size();
+}
+
+size_t SubRegistry::size() const
+{
+    Poco::FastMutex::ScopedLock l(m_mutex);
+    return m_entries.size();
+}
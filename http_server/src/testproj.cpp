@@ -20,6 +20,7 @@
 #include "op.hpp"
 
 #include <iostream>
+#include <algorithm>
 
 #include <boost/scoped_ptr.hpp>
 #include <boost/make_shared.hpp>
@@ -32,6 +33,7 @@
 #include <boost/random/variate_generator.hpp>
 
 #include <Poco/StringTokenizer.h>
+#include <Poco/Timestamp.h>
 #include <Poco/Net/DNS.h>
 
 #include <stdio.h>
@@ -40,22 +42,34 @@ using namespace haystack;
 
 
 
-TestProj::TestProj() : m_timer(1000, 1 * 60 * 1000) // once a minute
+TestProj::TestProj() : m_subs(m_recs),
+m_timer(1000, 1000), // lease tick
+m_version(0)
 {
     add_site("A", "Richmond", "VA", 1000);
     add_site("B", "Richmond", "VA", 2000);
     add_site("C", "Washington", "DC", 3000);
     add_site("D", "Boston", "MA", 4000);
 
+    // build the op table before serving
+    ops();
+
     Poco::TimerCallback<TestProj> callback(*this, &TestProj::on_timer);
     m_timer.start(callback);
 }
 
+TestProj::~TestProj()
+{
+    // the timer and workers call back into this project
+    m_timer.stop();
+    stop_workers();
+}
+
 const std::vector<const Op*>& TestProj::ops()
 {
     // lazy init
     if (m_ops != NULL)
-        return (std::vector<const Op*>&)*m_ops;
+        return *m_ops;
 
     std::vector<const Op*>* v = new std::vector<const Op*>();
 
@@ -66,18 +80,22 @@ const std::vector<const Op*>& TestProj::ops()
         v->push_back(it->second);
     }
 
-    return (std::vector<const Op*>&)*m_ops;
+    m_ops = v;
+    return *m_ops;
 }
 
 const Op* const TestProj::op(const std::string& name, bool checked) const
 {
-    const StdOps::ops_map_t& o_map = StdOps::ops_map();
-    std::map<std::string, const Op* const>::const_iterator it = o_map.find(name);
+    return op(name.data(), name.size(), checked);
+}
+
+const Op* const TestProj::op(const char* name, size_t len, bool checked) const
+{
+    const Op* o = StdOps::find(name, len);
 
-    if (checked && it == o_map.end())
+    if (checked && o == NULL)
         throw std::runtime_error("Unknown Op Name");
-    else
-        return it != o_map.end() ? it->second : NULL;
+    return o;
 }
 
 const Dict& TestProj::on_about() const
@@ -113,48 +131,18 @@ Dict::auto_ptr_t TestProj::on_read_by_id(const Ref& id) const
 Grid::auto_ptr_t TestProj::on_nav(const std::string& nav_id) const
 {
     // test database navId is record id
-    Dict::auto_ptr_t base;
-    if (!nav_id.empty()) base = read_by_id(Ref(nav_id));
-
-    // map base record to site, equip, or point
-    std::string filter = "site";
-    if (base.get() != NULL)
-    {
-        if (base->has("site")) filter = "equip and siteRef==" + base->id().to_code();
-        else if (base->has("equip")) filter = "point and equipRef==" + base->id().to_code();
-        else filter = "navNoChildren";
-    }
+    boost::shared_ptr<const Grid> g = m_nav.children(nav_id);
 
-    // read children of base record
-    Grid::auto_ptr_t read = read_all(filter);
-
-    Grid::auto_ptr_t res(new Grid);
-    res->reserve_rows(read->num_rows());
-
-    // copy columns
-    for (size_t i = 0; i < read->num_cols(); i++)
-    {
-        const Col& srcCol = read->col(i);
-        res->add_col(srcCol.name()).add(srcCol.meta());
-    }
-    // add a new colum
-    res->add_col("navId");
-    // copy rows
-    for (Grid::const_iterator row = read->begin(), e = read->end(); row != e; ++row)
+    // not a site or equip, check the record exists
+    if (g.get() == NULL)
     {
-        boost::scoped_ptr<Val*> v(new Val*[res->num_cols()]);
-        // copy each Val from the row
-        for (size_t i = 0; i < res->num_cols() - 1; i++)
-        {
-            (v.get())[i] = new_clone(row->get(res->col(i).name(), false));
-        }
-        // add the new 'navId' tag
-        (v.get())[res->num_cols() - 1] = new_clone(Str(row->id().value));
-        // add the new row to the result grid
-        res->add_row(v.get(), res->num_cols());
+        read_by_id(Ref(nav_id));
+        Grid::auto_ptr_t res(new Grid);
+        res->add_col("navId");
+        return res;
     }
 
-    return res;
+    return Grid::auto_ptr_t(new GridView(g));
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -163,13 +151,16 @@ Grid::auto_ptr_t TestProj::on_nav(const std::string& nav_id) const
 
 Watch::shared_ptr TestProj::on_watch_open(const std::string& dis)
 {
-    Watch::shared_ptr w = boost::make_shared<TestWatch>(*this, dis);
+    boost::shared_ptr<TestWatch> w = boost::make_shared<TestWatch>(*this, dis);
 
     {
         Poco::ScopedWriteRWLock l(m_lock);
         m_watches[w->id()] = w;
     }
 
+    // a watch that is never subscribed goes away after the default lease
+    renew(*w, w->lease());
+
     return w;
 }
 
@@ -193,7 +184,9 @@ Watch::shared_ptr TestProj::on_watch(const std::string& id)
     Watch::shared_ptr w;
     {
         Poco::ScopedReadRWLock l(m_lock);
-        w = m_watches[id];
+        watches_t::const_iterator it = m_watches.find(id);
+        if (it != m_watches.end())
+            w = it->second;
     }
     return  w;
 }
@@ -209,31 +202,91 @@ Dict::auto_ptr_t TestProj::on_nav_read_by_uri(const Uri& uri) const
 
 Grid::auto_ptr_t TestProj::on_point_write_array(const Dict& rec)
 {
-    Grid::auto_ptr_t g(new Grid);
+    boost::shared_ptr<const Grid> g;
+    {
+        Poco::FastMutex::ScopedLock l(m_write_lock);
+        writes_t::const_iterator it = m_writes.find(rec.id().value);
+        if (it != m_writes.end())
+            g = it->second->grid();
+    }
+
+    if (g.get() == NULL)
+    {
+        // never written
+        static const PriorityArray empty;
+        static const boost::shared_ptr<const Grid> empty_grid = empty.grid();
+        g = empty_grid;
+    }
 
-    g->add_col("level");
-    g->add_col("levelDis");
-    g->add_col("val");
-    g->add_col("who");
+    // the cached grid is shared, no rows are rebuilt
+    return Grid::auto_ptr_t(new GridView(g));
+}
 
-    for (int i = 0; i < 17; ++i)
+void TestProj::on_point_write(const Dict& rec, int level, const Val& val, const std::string& who, const Num& dur)
+{
+    Val::auto_ptr_t cur;
     {
-        Val* v[4] = {
-            new Num(i + 1),
-            new Str("" + (i + 1)),
-            new Num(i + 1),
-            new Str("boo"),
-        };
-        g->add_row(v, 4);
+        Poco::FastMutex::ScopedLock l(m_write_lock);
+        cur = write_level(rec.id().value, level, val, who, dur.type() == Val::NUM_TYPE ? &dur : NULL);
+    }
 
+    if (cur.get() != NULL)
+        cur_val(rec.id().value, *cur);
+}
+
+void TestProj::on_point_write(std::vector<PointWrite>& writes)
+{
+    boost::ptr_vector<boost::nullable<Val> > cur(writes.size());
+
+    // the whole batch under one lock acquisition
+    {
+        Poco::FastMutex::ScopedLock l(m_write_lock);
+        for (std::vector<PointWrite>::iterator it = writes.begin(), e = writes.end(); it != e; ++it)
+        {
+            try
+            {
+                cur.push_back(write_level(it->rec->id().value, it->level, *it->val, it->who, it->dur).release());
+            }
+            catch (std::exception& ex)
+            {
+                it->err = ex.what();
+                cur.push_back(NULL);
+            }
+        }
     }
 
-    return g;
+    for (size_t i = 0; i < writes.size(); ++i)
+    {
+        if (!cur.is_null(i))
+            cur_val(writes[i].rec->id().value, cur[i]);
+    }
 }
 
-void TestProj::on_point_write(const Dict& rec, int level, const Val& val, const std::string& who, const Num& dur)
+Val::auto_ptr_t TestProj::write_level(const std::string& id, int level, const Val& val, const std::string& who, const Num* dur)
 {
-    std::cout << "on_point_write" << rec.dis() << " " + val.to_string() << "@" << level << " [" << who << "]\n";
+    writes_t::iterator it = m_writes.find(id);
+    if (it == m_writes.end())
+    {
+        std::string k(id);
+        it = m_writes.insert(k, new PriorityArray(id)).first;
+    }
+    PriorityArray& pa = *it->second;
+
+    // dur is checked before the level changes
+    const bool changed = pa.write(level, val, who, dur);
+
+    // timed write, released by the wheel
+    PriorityArray::Slot& slot = pa.slot(level);
+    if (slot.duration() > 0)
+    {
+        m_write_timers.schedule(slot, (slot.duration() + 999) / 1000);
+    }
+    else
+    {
+        m_write_timers.cancel(slot);
+    }
+
+    return changed && pa.val() != NULL ? pa.val()->clone() : Val::auto_ptr_t();
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -242,9 +295,20 @@ void TestProj::on_point_write(const Dict& rec, int level, const Val& val, const
 
 std::vector<HisItem> TestProj::on_his_read(const Dict& entity, const DateTimeRange& range)
 {
-    // generate dummy 15min data
     std::vector<HisItem> acc;
 
+    // read back the written history
+    {
+        Poco::ScopedReadRWLock l(m_his_lock);
+        his_t::const_iterator it = m_his.find(entity.id().value);
+        if (it != m_his.end())
+        {
+            it->second->read(range.start().millis(), range.end().millis(), range.start().tz, acc);
+            return acc;
+        }
+    }
+
+    // generate dummy 15min data
     DateTime::auto_ptr_t ts = range.start().clone();
     bool isBool = entity.get_str("kind") == "Bool";
     while (ts->as<DateTime>() < range.end())
@@ -261,9 +325,77 @@ std::vector<HisItem> TestProj::on_his_read(const Dict& entity, const DateTimeRan
     return acc;
 }
 
+void TestProj::on_his_rollup(const Dict& rec, const DateTimeRange& range, HisRollup& rollup)
+{
+    std::vector<int64_t> ts;
+    std::vector<double> vals;
+
+    // decode straight into contiguous arrays, no HisItem allocations
+    bool found;
+    {
+        Poco::ScopedReadRWLock l(m_his_lock);
+        his_t::const_iterator it = m_his.find(rec.id().value);
+        found = it != m_his.end();
+        if (found)
+            it->second->read(range.start().millis(), range.end().millis(), ts, vals);
+    }
+
+    // the fallback reads the history again, not under the lock
+    if (!found)
+        return Server::on_his_rollup(rec, range, rollup);
+
+    rollup.add(ts, vals);
+}
+
 void TestProj::on_his_write(const Dict& rec, const std::vector<HisItem>& items)
 {
-    throw std::runtime_error("Unsupported Op 'on_his_write'");
+    const bool isBool = rec.has("kind") && rec.get_str("kind") == "Bool";
+    const Val::Type type = isBool ? Val::BOOL_TYPE : Val::NUM_TYPE;
+
+    // encode outside of the lock
+    std::vector<HisChunk::Sample> samples;
+    samples.reserve(items.size());
+    for (std::vector<HisItem>::const_iterator it = items.begin(), e = items.end(); it != e; ++it)
+    {
+        if (it->val->type() != type)
+            throw std::runtime_error("Invalid his value for " + rec.dis() + ": " + it->val->to_string());
+
+        const double v = isBool ? (it->val->as<Bool>().value ? 1.0 : 0.0) : it->val->as<Num>().value;
+        samples.push_back(HisChunk::Sample(it->ts->millis(), v, it->ts->tz_offset));
+    }
+
+    on_his_append(rec, samples);
+}
+
+void TestProj::on_his_append(const Dict& rec, std::vector<HisChunk::Sample>& samples)
+{
+    const bool isBool = rec.has("kind") && rec.get_str("kind") == "Bool";
+
+    HisChunk::Sample last;
+    bool is_last = false;
+    {
+        Poco::ScopedWriteRWLock l(m_his_lock);
+        his_t::iterator it = m_his.find(rec.id().value);
+        if (it == m_his.end())
+        {
+            std::string k = rec.id().value;
+            it = m_his.insert(k, new HisSeries(isBool ? HisChunk::BOOL_KIND : HisChunk::NUM_KIND,
+                rec.has("unit") ? rec.get_str("unit") : "")).first;
+        }
+
+        last = *std::max_element(samples.begin(), samples.end());
+        it->second->merge(samples);
+        is_last = last.ts == it->second->last_ts();
+    }
+
+    // the newest sample becomes the current value
+    if (is_last)
+    {
+        if (isBool)
+            cur_val(rec.id().value, Bool(last.val != 0.0));
+        else
+            cur_val(rec.id().value, Num(last.val, rec.has("unit") ? rec.get_str("unit") : ""));
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -297,8 +429,7 @@ void TestProj::add_site(const std::string& dis, const std::string& geoCity, cons
     add_ahu(*site, dis + "-AHU1");
     add_ahu(*site, dis + "-AHU2");
 
-    std::string k = dis;
-    m_recs.insert(k, site);
+    add_rec(site);
 }
 
 void TestProj::add_meter(Dict& site, const std::string& dis)
@@ -314,8 +445,7 @@ void TestProj::add_meter(Dict& site, const std::string& dis)
     add_point(*equip, dis + "-KW", "kW", "elecKw");
     add_point(*equip, dis + "-KWH", "kWh", "elecKwh");
 
-    std::string k = dis;
-    m_recs.insert(k, equip);
+    add_rec(equip);
 }
 
 void TestProj::add_ahu(Dict& site, const std::string& dis)
@@ -334,8 +464,7 @@ void TestProj::add_ahu(Dict& site, const std::string& dis)
     add_point(*equip, dis + "-RTemp", "\xE2\x84\x89", "return air temp sensor");
     add_point(*equip, dis + "-ZoneSP", "\xE2\x84\x89", "zone air temp sp writable");
 
-    std::string k = dis;
-    m_recs.insert(k, equip);
+    add_rec(equip);
 }
 
 void TestProj::add_point(Dict& equip, const std::string& dis, const std::string& unit, const std::string& markers)
@@ -358,48 +487,158 @@ void TestProj::add_point(Dict& equip, const std::string& dis, const std::string&
     for (Poco::StringTokenizer::Iterator it = st.begin(), end = st.end(); it != end; ++it)
         d->add(*it);
 
-    std::string k = dis;
-    m_recs.insert(k, d);
+    add_rec(d);
+
+    // simulated current value
+    static boost::mt19937 rng(static_cast<uint32_t>(time(NULL)));
+    boost::uniform_real<> range(0.0, 100.0);
+    boost::variate_generator<boost::mt19937&, boost::uniform_real<> > gen(rng, range);
+    if (unit.empty())
+        cur_val(dis, Bool(((int)gen()) % 2 == 0));
+    else
+        cur_val(dis, Num(gen(), unit));
+}
+
+void TestProj::add_rec(Dict::auto_ptr_t rec)
+{
+    const Dict& r = *rec;
+    std::string k = r.id().value;
+    m_recs.insert(k, rec);
+    m_nav.add(r);
+}
+
+//////////////////////////////////////////////////////////////////////////
+// Current Values
+//////////////////////////////////////////////////////////////////////////
+
+void TestProj::cur_val(const std::string& id, const Val& val)
+{
+    Poco::Mutex::ScopedLock l(m_cur_lock);
+
+    cur_vals_t::iterator it = m_cur_vals.find(id);
+    if (it == m_cur_vals.end())
+    {
+        std::string k(id);
+        m_cur_vals.insert(k, (Val*)val.clone().release());
+    }
+    else
+    {
+        m_cur_vals.replace(it, (Val*)val.clone().release());
+    }
+
+    ++m_version;
+
+    // fan out to the interested watches, then wake up parked polls
+    m_subs.notify(id);
+    m_cur_changed.broadcast();
+}
+
+void TestProj::add_cur_val(Dict& row, const std::string& id) const
+{
+    Poco::Mutex::ScopedLock l(m_cur_lock);
+
+    cur_vals_t::const_iterator it = m_cur_vals.find(id);
+    if (it != m_cur_vals.end())
+        row.add("curVal", *it->second);
+}
+
+uint64_t TestProj::version() const
+{
+    Poco::Mutex::ScopedLock l(m_cur_lock);
+    return m_version;
+}
+
+bool TestProj::wait_changes(uint64_t since, long timeout) const
+{
+    Poco::Mutex::ScopedLock l(m_cur_lock);
+
+    const Poco::Timestamp start;
+    while (m_version <= since)
+    {
+        const long left = timeout - (long)(start.elapsed() / 1000);
+        if (left <= 0 || !m_cur_changed.tryWait(m_cur_lock, left))
+            return m_version > since;
+    }
+    return true;
+}
+
+void TestProj::renew(TestWatch& w, int secs) const
+{
+    Poco::FastMutex::ScopedLock l(m_lease_lock);
+    if (!w.m_expired)
+        m_leases.schedule(w, secs > 0 ? secs : 0);
 }
 
 void TestProj::on_timer(Poco::Timer& timer)
 {
-    std::vector<Watch::shared_ptr> del;
-    // detect garbage watches
+    expire_writes();
+    expire_watches();
+}
+
+void TestProj::expire_writes()
+{
+    std::vector<TimerWheel::Entry*> expired;
+    boost::ptr_vector<Val> vals;
+    std::vector<std::string> ids;
+
     {
-        Poco::ScopedReadRWLock l(m_lock);
-        for (watches_t::const_iterator it = m_watches.begin(), e = m_watches.end(); it != e; ++it)
-        {
-            TestWatch& w = (TestWatch&)*it->second.get();
+        Poco::FastMutex::ScopedLock l(m_write_lock);
+        m_write_timers.tick(expired);
 
-            if (w.is_open() && w.lease() > 0)
+        for (std::vector<TimerWheel::Entry*>::const_iterator it = expired.begin(), e = expired.end(); it != e; ++it)
+        {
+            PriorityArray::Slot& slot = static_cast<PriorityArray::Slot&>(**it);
+            PriorityArray& pa = slot.array();
+            if (pa.release(slot.level()) && pa.val() != NULL)
             {
-                int lease = w.lease();
-                lease -= 1 * 60;
-                w.lease(lease);
-                // mark for delete
-                if (lease < 0)
-                    del.push_back(it->second);
+                ids.push_back(pa.id());
+                vals.push_back(pa.val()->clone());
             }
+        }
+    }
 
-            if (!w.is_open() && w.lease() > 0)
-            {
-                del.push_back(it->second);
-            }
+    for (size_t i = 0; i < ids.size(); ++i)
+        cur_val(ids[i], vals[i]);
+}
 
+void TestProj::expire_watches()
+{
+    std::vector<TimerWheel::Entry*> expired;
+    std::vector<std::string> ids;
+
+    // only the watches whose lease ran out this second
+    {
+        Poco::FastMutex::ScopedLock l(m_lease_lock);
+        m_leases.tick(expired);
+
+        for (std::vector<TimerWheel::Entry*>::const_iterator it = expired.begin(), e = expired.end(); it != e; ++it)
+        {
+            TestWatch& w = static_cast<TestWatch&>(**it);
+            w.m_expired = true;
+            w.m_is_open = 0;
+            ids.push_back(w.id());
         }
     }
 
-    if (!del.empty())
+    if (ids.empty())
+        return;
+
+    std::vector<Watch::shared_ptr> del;
     {
         Poco::ScopedWriteRWLock l(m_lock);
-        for (std::vector<Watch::shared_ptr>::const_iterator it = del.begin(), e = del.end(); it != e; ++it)
+        for (std::vector<std::string>::const_iterator it = ids.begin(), e = ids.end(); it != e; ++it)
         {
-            watches_t::iterator pos = m_watches.find((**it).id());
+            watches_t::iterator pos = m_watches.find(*it);
+            if (pos == m_watches.end())
+                continue;
+            del.push_back(pos->second);
             m_watches.erase(pos);
         }
     }
 
+    // outside of the locks, a watch locks itself then the registry
+    for (std::vector<Watch::shared_ptr>::const_iterator it = del.begin(), e = del.end(); it != e; ++it)
+        static_cast<TestWatch&>(**it).release();
 }
 
 Dict* TestProj::m_about = NULL;
@@ -425,8 +664,15 @@ TestWatch::TestWatch(const TestProj& server, const std::string& dis) :
 m_server(server),
 m_uuid(boost::lexical_cast<std::string>(boost::uuids::random_generator()())),
 m_dis(dis),
-m_lease(std::numeric_limits<Poco::AtomicCounter::ValueType>::min()),
-m_is_open(false){}
+m_version(0),
+m_lease(DEFAULT_LEASE_TIME),
+m_is_open(0),
+m_expired(false){}
+
+TestWatch::~TestWatch()
+{
+    release();
+}
 
 const std::string TestWatch::id() const
 {
@@ -446,88 +692,223 @@ const int TestWatch::lease() const
 void TestWatch::lease(int value)
 {
     m_lease = value;
+    m_server.renew(*this, value);
 }
 
 Grid::auto_ptr_t TestWatch::sub(const refs_t& ids, bool checked)
 {
-    m_ids = ids;
-
-    const TestProj::recs_t& recs = m_server.m_recs;
+    Poco::Mutex::ScopedLock l(m_mutex);
 
+    // only ids this watch does not have yet go to the registry
+    std::vector<std::string> add;
     std::vector<const Dict*> res;
-
-    for (refs_t::iterator id = m_ids.begin(), e = m_ids.end(); id != e; ++id)
+    add.reserve(ids.size());
+    res.reserve(ids.size());
+    for (refs_t::const_iterator id = ids.begin(), e = ids.end(); id != e; ++id)
     {
-        TestProj::recs_t::const_iterator rec = recs.find(id->value);
-
-        if (rec == recs.end())
-        {
-            m_ids.erase(id);
+        ids_t::const_iterator it = m_ids.find(id->value);
+        if (it != m_ids.end())
+            res.push_back(it->second);
+        else if (std::find(add.begin(), add.end(), id->value) == add.end())
+            add.push_back(id->value);
+    }
 
-            if (checked)
-                throw std::runtime_error("Id not found: " + id->value);
+    std::vector<const Dict*> recs;
+    m_server.m_subs.sub(*this, add, recs);
 
+    const std::string* missing = NULL;
+    for (size_t i = 0; i < add.size(); ++i)
+    {
+        if (recs[i] == NULL)
+        {
+            if (missing == NULL) missing = &add[i];
             continue;
         }
+        m_ids.insert(std::make_pair(add[i], recs[i]));
+        res.push_back(recs[i]);
+    }
 
-        res.push_back(rec->second);
+    if (missing != NULL && checked)
+    {
+        // undo, a failed sub does not change the watch
+        std::vector<std::string> undo;
+        for (size_t i = 0; i < add.size(); ++i)
+        {
+            if (recs[i] == NULL)
+                continue;
+            undo.push_back(add[i]);
+            m_ids.erase(add[i]);
+        }
+        m_server.m_subs.unsub(*this, undo);
+        throw std::runtime_error("Id not found: " + *missing);
     }
 
-    m_is_open = true;
-    m_lease = DEFAULT_LEASE_TIME;
+    // changes before this point are covered by the sub response
+    if (m_is_open == 0)
+        m_version = m_server.version();
 
-    Grid::auto_ptr_t g = Grid::make(res);
-    g->meta().add("watchId", m_uuid).add("lease", m_lease);
+    m_is_open = 1;
+    m_server.renew(*this, m_lease);
 
-    return g;
+    return make_grid(res);
 }
 
 void TestWatch::unsub(const refs_t& ids)
 {
-    for (refs_t::iterator id = m_ids.begin(), e = m_ids.end(); id != e; ++id)
+    Poco::Mutex::ScopedLock l(m_mutex);
+
+    std::vector<std::string> del;
+    for (refs_t::const_iterator id = ids.begin(), e = ids.end(); id != e; ++id)
     {
-        if (std::find(ids.begin(), ids.end(), *id) != ids.end())
-        {
-            m_ids.erase(id);
-        }
+        if (m_ids.erase(id->value) > 0)
+            del.push_back(id->value);
     }
+    m_server.m_subs.unsub(*this, del);
+
+    Poco::FastMutex::ScopedLock p(m_pending_lock);
+    for (std::vector<std::string>::const_iterator id = del.begin(), e = del.end(); id != e; ++id)
+        m_pending.erase(*id);
+}
+
+void TestWatch::release()
+{
+    Poco::Mutex::ScopedLock l(m_mutex);
+
+    std::vector<std::string> del;
+    del.reserve(m_ids.size());
+    for (ids_t::const_iterator it = m_ids.begin(), e = m_ids.end(); it != e; ++it)
+        del.push_back(it->first);
+    m_ids.clear();
+
+    m_server.m_subs.unsub(*this, del);
+}
+
+void TestWatch::on_change(const std::string& id)
+{
+    Poco::FastMutex::ScopedLock l(m_pending_lock);
+    m_pending.insert(id);
 }
 
 Grid::auto_ptr_t TestWatch::poll_changes()
 {
-    return poll_refresh();
+    Poco::Mutex::ScopedLock l(m_mutex);
+
+    // read the version first, later changes stay pending for the next poll
+    m_version = m_server.version();
+
+    std::set<std::string> changed;
+    {
+        Poco::FastMutex::ScopedLock p(m_pending_lock);
+        changed.swap(m_pending);
+    }
+
+    std::vector<const Dict*> recs;
+    recs.reserve(changed.size());
+    for (std::set<std::string>::const_iterator id = changed.begin(), e = changed.end(); id != e; ++id)
+    {
+        ids_t::const_iterator it = m_ids.find(*id);
+        if (it != m_ids.end())
+            recs.push_back(it->second);
+    }
+
+    m_server.renew(*this, m_lease);
+
+    return make_grid(recs);
+}
+
+Grid::auto_ptr_t TestWatch::poll_changes(long timeout)
+{
+    Grid::auto_ptr_t g = poll_changes();
+    if (g->num_rows() > 0 || timeout <= 0)
+        return g;
+
+    // a parked poll holds an HTTP worker thread, keep most of them free
+    if (++m_server.m_parked_polls > TestProj::MAX_PARKED_POLLS)
+    {
+        --m_server.m_parked_polls;
+        return g;
+    }
+
+    try
+    {
+        g = wait_changes(timeout);
+    }
+    catch (...)
+    {
+        --m_server.m_parked_polls;
+        throw;
+    }
+    --m_server.m_parked_polls;
+
+    return g;
+}
+
+Grid::auto_ptr_t TestWatch::stream_changes(long timeout)
+{
+    Grid::auto_ptr_t g = poll_changes();
+    if (g->num_rows() > 0 || timeout <= 0)
+        return g;
+    return wait_changes(timeout);
+}
+
+Grid::auto_ptr_t TestWatch::wait_changes(long timeout)
+{
+    const Poco::Timestamp start;
+    for (;;)
+    {
+        uint64_t seen;
+        {
+            Poco::Mutex::ScopedLock l(m_mutex);
+            seen = m_version;
+        }
+
+        const long left = timeout - (long)(start.elapsed() / 1000);
+        if (left <= 0 || !m_server.wait_changes(seen, left))
+            break;
+
+        // a change, may not be one of ours
+        Grid::auto_ptr_t g = poll_changes();
+        if (g->num_rows() > 0)
+            return g;
+    }
+    return make_grid(std::vector<const Dict*>());
 }
 
 Grid::auto_ptr_t TestWatch::poll_refresh()
 {
-    const TestProj::recs_t& recs = m_server.m_recs;
-    boost::ptr_vector<Dict> res;
+    Poco::Mutex::ScopedLock l(m_mutex);
 
-    boost::mt19937 rng(static_cast<uint32_t>(time(NULL)));
-    boost::uniform_real<> range(0.0, 100.0);
-    boost::variate_generator<boost::mt19937&, boost::uniform_real<> > gen(rng, range);
+    m_version = m_server.version();
+    {
+        Poco::FastMutex::ScopedLock p(m_pending_lock);
+        m_pending.clear();
+    }
+
+    std::vector<const Dict*> recs;
+    recs.reserve(m_ids.size());
+    for (ids_t::const_iterator it = m_ids.begin(), e = m_ids.end(); it != e; ++it)
+        recs.push_back(it->second);
+
+    m_server.renew(*this, m_lease);
 
-    for (refs_t::iterator id = m_ids.begin(), e = m_ids.end(); id != e; ++id)
+    return make_grid(recs);
+}
+
+Grid::auto_ptr_t TestWatch::make_grid(const std::vector<const Dict*>& recs)
+{
+    boost::ptr_vector<Dict> res(recs.size());
+
+    for (std::vector<const Dict*>::const_iterator rec = recs.begin(), e = recs.end(); rec != e; ++rec)
     {
-        TestProj::recs_t::const_iterator rec = recs.find(id->value);
         Dict::auto_ptr_t row(new Dict);
         // clone the record
-        row->add(*rec->second);
+        row->add(**rec);
         // add the cur value
-        if (rec->second->get_str("kind") == "Number")
-        {
-            row->add("curVal", Num(gen()));
-        }
-        else if (rec->second->get_str("kind") == "Bool")
-        {
-            row->add("curVal", Bool((((int)gen()) % 2 == 0 ? true : false)));
-        }
+        m_server.add_cur_val(*row, (**rec).id().value);
 
         res.push_back(row);
     }
 
-    m_lease = DEFAULT_LEASE_TIME;
-
     Grid::auto_ptr_t g = Grid::make(res);
     g->meta().add("watchId", m_uuid).add("lease", m_lease);
     return g;
@@ -535,10 +916,11 @@ Grid::auto_ptr_t TestWatch::poll_refresh()
 
 void TestWatch::close()
 {
-    m_is_open = false;
+    m_is_open = 0;
+    m_server.renew(*this, 0);
 }
 
 bool TestWatch::is_open() const
 {
-    return m_is_open;
+    return m_is_open != 0;
 }
@@ -28,7 +28,7 @@ namespace haystack {
         DateTime& operator = (const DateTime &other);
         friend class DateTimeRange;
         DateTime(const DateTime &other) : date(other.date), time(other.time),
-            tz(other.tz), tz_offset(tz.offset * 3600),
+            tz(other.tz), tz_offset(other.tz_offset),
             m_millis(other.m_millis)  {};
     public:
         const Type type() const { return DATE_TIME_TYPE; }
@@ -71,6 +71,10 @@ namespace haystack {
         */
         static DateTime make(const int64_t& time, const TimeZone& = TimeZone::DEFAULT);
         /**
+        construct from millis using the given offset in seconds from UTC
+        */
+        static DateTime make(const int64_t& time, const TimeZone& tz, int tz_offset);
+        /**
         Get DateTime for current time in default timezone or optionaly for given timezone
         */
         static DateTime now(const TimeZone& = TimeZone::DEFAULT);
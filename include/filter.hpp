@@ -192,13 +192,17 @@ namespace haystack {
     //////////////////////////////////////////////////////////////////////////
     class PathFilter : public Filter
     {
+    public:
+        /**
+        Tag path the filter tests.
+        */
+        const Path* path() const;
     protected:
         PathFilter(Path::auto_ptr_t p);
         virtual ~PathFilter(){}
         bool include(const Dict& dict, const Pather& pather) const;
         virtual bool do_include(const Val& val) const = 0;
         std::string str() const;
-        const Path* path() const;
         Path::auto_ptr_t m_path;
     };
 
@@ -229,12 +233,19 @@ namespace haystack {
     //////////////////////////////////////////////////////////////////////////
     class CmpFilter : public PathFilter
     {
+    public:
+        /**
+        Comparison operator, such as "==".
+        */
+        virtual std::string cmp_str() const = 0;
+        /**
+        Value the tag is compared to.
+        */
+        const Val& val() const;
     protected:
         CmpFilter(Path::auto_ptr_t, Val::auto_ptr_t v);
         std::string str() const;
         bool same_type(const Val& v) const;
-        virtual std::string cmp_str() const = 0;
-        const Val& val() const;
         Val::auto_ptr_t m_val;
     };
 
@@ -309,17 +320,23 @@ namespace haystack {
     //////////////////////////////////////////////////////////////////////////
     class CompoundFilter : public Filter
     {
+    public:
+        /**
+        Logical operator, "and" or "or".
+        */
+        virtual std::string keyword() const = 0;
+        /**
+        First and second operand.
+        */
+        const Filter& a() const;
+        const Filter& b() const;
     protected:
 
         CompoundFilter(Filter::shared_ptr_t a, Filter::shared_ptr_t b);
         virtual ~CompoundFilter(){}
-        virtual std::string keyword() const = 0;
         Type type() const;
         std::string str() const;
 
-        const Filter& a() const;
-        const Filter& b() const;
-
         Filter::shared_ptr_t m_a;
         Filter::shared_ptr_t m_b;
     };
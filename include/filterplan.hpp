@@ -0,0 +1,145 @@
+#pragma once
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "filter.hpp"
+#include "grid.hpp"
+#include <map>
+#include <vector>
+#include <stdint.h>
+
+namespace haystack {
+
+    /**
+     TagStats counts the records defining each tag, to estimate how many
+     records a filter matches and what it costs to evaluate.
+     */
+    class TagStats : boost::noncopyable
+    {
+    public:
+        TagStats() : m_total(0) {}
+
+        void add(const Dict& rec);
+
+        size_t total() const { return m_total; }
+        size_t count(const std::string& tag) const;
+
+        /**
+        Fraction of the records defining tag, 1.0 without records
+        */
+        double frequency(const std::string& tag) const;
+
+        /**
+        Estimated fraction of the records filter f matches. Tags of a
+        path and the operands of a compound are taken as independent,
+        comparisons keep a fixed share of the records defining the tag.
+        */
+        double selectivity(const Filter& f) const;
+
+        /**
+        Estimated cost to evaluate f on one record, in tag lookups. A
+        ref followed by a path costs a record lookup, and the second
+        operand of a compound only runs when the first does not decide.
+        */
+        double cost(const Filter& f) const;
+
+        // share of the records defining the tag kept by a comparison
+        static const double EQ_SELECTIVITY;
+        static const double NE_SELECTIVITY;
+        static const double RANGE_SELECTIVITY;
+        // tag lookups a ref lookup costs
+        static const double HOP_COST;
+
+    private:
+        // selectivity of the records defining the path
+        double has_selectivity(const Path& path) const;
+
+        size_t m_total;
+        std::map<std::string, size_t> m_counts;
+    };
+
+    /**
+     FilterPlan is how a filter read runs: the access path, a scan of all
+     records or a lookup of the record named by an id == @ref conjunct,
+     and the optimized filter tree with the estimated selectivity and
+     cost of each node. Records matched with include() are counted per
+     node, so the plan can report what a read actually did.
+     */
+    class FilterPlan : boost::noncopyable
+    {
+    public:
+        struct Node
+        {
+            const Filter* filter;
+            // and, or, has, missing or the comparison operator
+            std::string op;
+            size_t depth;
+            double selectivity;
+            double cost;
+            // records the node was evaluated on and matched
+            uint64_t evaluated;
+            uint64_t matched;
+            std::vector<size_t> children;
+        };
+
+        FilterPlan(Filter::shared_ptr_t filter, const TagStats& stats);
+
+        /**
+        Optimized filter the plan evaluates
+        */
+        const Filter& filter() const { return *m_filter; }
+
+        /**
+        Id of the only record the filter can match, empty to scan
+        */
+        const std::string& index_id() const { return m_index_id; }
+
+        /**
+        Access path, "id index" or "scan"
+        */
+        std::string access() const;
+
+        /**
+        Match rec like Filter::include, counting the evaluations
+        */
+        bool include(const Dict& rec, const Pather& pather);
+
+        /**
+        Nodes of the filter tree, depth first
+        */
+        const std::vector<Node>& nodes() const { return m_nodes; }
+
+        /**
+        One row per node with its depth, op, filter, estimates and counts
+        */
+        Grid::auto_ptr_t to_grid() const;
+
+        /**
+        Id of the only record f can match, empty if f has no id == @ref
+        conjunct
+        */
+        static std::string index_id(const Filter& f);
+
+        /**
+        Equivalent filter which is cheaper to evaluate: nested and / or
+        operands are flattened, duplicates removed and the operands
+        ordered so the ones most likely to decide the result at the
+        least cost run first, for and the cheap selective tests, such
+        as markers, before ref paths.
+        */
+        static Filter::shared_ptr_t optimize(Filter::shared_ptr_t f, const TagStats& stats);
+
+    private:
+        size_t add(const Filter& f, size_t depth, const TagStats& stats);
+        bool include(size_t node, const Dict& rec, const Pather& pather);
+
+        const Filter::shared_ptr_t m_original;
+        const Filter::shared_ptr_t m_filter;
+        std::string m_index_id;
+        std::vector<Node> m_nodes;
+    };
+};
@@ -14,6 +14,7 @@
 #include "col.hpp"
 #include <stdexcept>
 #include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/shared_ptr.hpp>
 
 namespace haystack {
     /**
@@ -243,6 +244,29 @@ namespace haystack {
         GridView(const Grid& g) :
             m_meta(g.m_meta),
             m_cols_by_name(g.m_cols_by_name)
+        {
+            init(g);
+        }
+
+        /**
+        View of a shared grid, the view keeps the grid alive.
+        */
+        GridView(const boost::shared_ptr<const Grid>& g) :
+            m_meta(g->m_meta),
+            m_cols_by_name(g->m_cols_by_name),
+            m_owner(g)
+        {
+            init(*g);
+        }
+
+        GridView(const GridView& gv) : m_meta(gv.m_meta),
+            m_rows(gv.m_rows),
+            m_cols(gv.m_cols),
+            m_cols_by_name(gv.m_cols_by_name),
+            m_owner(gv.m_owner) {}
+
+    private:
+        void init(const Grid& g)
         {
             m_rows.reserve(g.m_rows.size());
             m_cols.reserve(g.m_cols.size());
@@ -258,16 +282,12 @@ namespace haystack {
             }
         }
 
-        GridView(const GridView& gv) : m_meta(gv.m_meta),
-            m_rows(gv.m_rows),
-            m_cols(gv.m_cols),
-            m_cols_by_name(gv.m_cols_by_name) {}
-
-    private:
         const Dict& m_meta;
         row_vec_t m_rows;
         col_vec_t m_cols;
         const name_col_map_t& m_cols_by_name;
+        // set when the view shares ownership of the source grid
+        boost::shared_ptr<const Grid> m_owner;
         // hide base methods
         Dict& add_col(const std::string& name);
         Grid& add_row(Val *[], size_t count);
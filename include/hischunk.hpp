@@ -0,0 +1,195 @@
+#pragma once
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "headers.hpp"
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <vector>
+#include <stdint.h>
+
+namespace haystack {
+    class TimeZone;
+    class HisItem;
+
+    /**
+     HisChunk is a compressed block of time-series samples.
+
+     Timestamps are stored as delta-of-delta millis, Number values are
+     XOR-compressed against the previous value and Bool values are
+     run-length encoded. Regular interval samples cost a few bits each.
+     Samples must be appended in strictly increasing timestamp order and
+     all samples of a chunk share the same UTC offset.
+     */
+    class HisChunk
+    {
+    public:
+        /**
+        Kind of values stored in the chunk
+        */
+        enum Kind
+        {
+            NUM_KIND = 'N',
+            BOOL_KIND = 'B'
+        };
+
+        /**
+        Max number of samples held by a chunk
+        */
+        enum { MAX_SAMPLES = 1024 };
+
+        /**
+        Decoded sample
+        */
+        struct Sample
+        {
+            int64_t ts;
+            double val;
+            int tz_offset;
+
+            Sample() : ts(0), val(0.0), tz_offset(0) {}
+            Sample(int64_t ts, double val, int tz_offset) : ts(ts), val(val), tz_offset(tz_offset) {}
+            bool operator < (const Sample& other) const { return ts < other.ts; }
+        };
+
+        HisChunk(Kind kind, int tz_offset);
+
+        Kind kind() const { return m_kind; }
+
+        /**
+        Offset in seconds from UTC shared by all samples
+        */
+        int tz_offset() const { return m_tz_offset; }
+
+        /**
+        Number of samples
+        */
+        size_t size() const { return m_count; }
+        bool is_full() const { return m_count >= MAX_SAMPLES; }
+
+        /**
+        Timestamp millis of the first and last sample
+        */
+        int64_t first_ts() const { return m_first_ts; }
+        int64_t last_ts() const { return m_last_ts; }
+
+        /**
+        Approximate memory used by the encoded samples
+        */
+        size_t byte_size() const;
+
+        /**
+        Append a sample, return false if the chunk is full or the
+        timestamp is not after the last sample.
+        */
+        bool append(int64_t ts, double val);
+
+        /**
+        Release spare capacity once no more samples are appended.
+        */
+        void seal();
+
+        /**
+        Decode all samples, appending them to the given vectors.
+        */
+        void decode(std::vector<int64_t>& ts, std::vector<double>& vals) const;
+
+        /**
+        Decode all samples, appending them to the given vector.
+        */
+        void decode(std::vector<Sample>& samples) const;
+
+    private:
+        void write_bits(uint64_t bits, int n);
+        void write_ts(int64_t ts);
+        void write_num(double val);
+        void write_bool(bool val);
+
+        Kind m_kind;
+        int m_tz_offset;
+        size_t m_count;
+
+        // encoded timestamps and Number values
+        std::vector<uint8_t> m_bits;
+        size_t m_bit_len;
+
+        // closed Bool runs as varints
+        std::vector<uint8_t> m_runs;
+
+        // encoder state
+        int64_t m_first_ts;
+        int64_t m_last_ts;
+        int64_t m_last_delta;
+        uint64_t m_last_val;
+        int m_leading;
+        int m_trailing;
+        bool m_first_bool;
+        bool m_run_val;
+        uint32_t m_run_len;
+    };
+
+    /**
+     HisSeries is the compressed history of one point as an ordered
+     list of HisChunk. Out of order and duplicate samples are merged,
+     a duplicate timestamp replaces the stored value.
+     */
+    class HisSeries : boost::noncopyable
+    {
+    public:
+        HisSeries(HisChunk::Kind kind, const std::string& unit = "");
+
+        HisChunk::Kind kind() const { return m_kind; }
+        const std::string& unit() const { return m_unit; }
+
+        /**
+        Number of samples
+        */
+        size_t size() const { return m_count; }
+
+        /**
+        Approximate memory used by the encoded samples
+        */
+        size_t byte_size() const;
+
+        /**
+        Timestamp millis of the first and last sample, 0 if empty
+        */
+        int64_t first_ts() const;
+        int64_t last_ts() const;
+
+        /**
+        Add a sample
+        */
+        void append(int64_t ts, double val, int tz_offset);
+
+        /**
+        Add a batch of samples in any order
+        */
+        void merge(std::vector<HisChunk::Sample>& samples);
+
+        /**
+        Decode samples with start < ts <= end
+        */
+        void read(int64_t start, int64_t end, std::vector<int64_t>& ts, std::vector<double>& vals) const;
+
+        /**
+        Decode samples with start < ts <= end as HisItems in the given timezone
+        */
+        void read(int64_t start, int64_t end, const TimeZone& tz, std::vector<HisItem>& items) const;
+
+    private:
+        typedef boost::ptr_vector<HisChunk> chunks_t;
+
+        // index of the first chunk that may hold samples after ts
+        size_t find_chunk(int64_t ts) const;
+        void push(const HisChunk::Sample& s);
+
+        const HisChunk::Kind m_kind;
+        const std::string m_unit;
+        chunks_t m_chunks;
+        size_t m_count;
+    };
+};
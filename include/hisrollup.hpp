@@ -0,0 +1,107 @@
+#pragma once
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "headers.hpp"
+#include <vector>
+#include <stdint.h>
+
+namespace haystack {
+    class Num;
+
+    /**
+     HisRollup reduces time-series samples into fixed interval buckets
+     in a single pass. Samples must be added in timestamp order.
+
+     Buckets are aligned on the interval in local time and are labeled
+     with their start timestamp; a bucket covers [start, start + interval).
+     */
+    class HisRollup
+    {
+    public:
+        /**
+        Rollup functions
+        */
+        enum Func
+        {
+            AVG,
+            MIN,
+            MAX,
+            SUM,
+            COUNT,
+            FIRST,
+            LAST
+        };
+
+        /**
+        Parse rollup function name: avg, min, max, sum, count, first or last.
+        Throw runtime_error if unknown.
+        */
+        static Func parse(const std::string& name);
+
+        /**
+        Name of the rollup function
+        */
+        static const std::string name(Func func);
+
+        /**
+        Convert a positive interval Num to millis, see Num::millis.
+        Throw runtime_error if invalid.
+        */
+        static int64_t interval_millis(const Num& interval);
+
+        /**
+        Construct for the given function, interval millis and offset in
+        seconds from UTC used to align buckets in local time.
+        */
+        HisRollup(Func func, int64_t interval, int tz_offset = 0);
+
+        Func func() const { return m_func; }
+        int64_t interval() const { return m_interval; }
+        int tz_offset() const { return m_tz_offset; }
+
+        /**
+        Add a sample
+        */
+        void add(int64_t ts, double val);
+
+        /**
+        Add a block of samples, reduces each bucket run in a tight loop
+        */
+        void add(const int64_t* ts, const double* vals, size_t count);
+        void add(const std::vector<int64_t>& ts, const std::vector<double>& vals);
+
+        /**
+        Close the current bucket, call before reading the results.
+        */
+        void finish();
+
+        /**
+        Bucket start timestamps millis and reduced values
+        */
+        const std::vector<int64_t>& ts() const { return m_ts; }
+        const std::vector<double>& vals() const { return m_vals; }
+
+    private:
+        int64_t bucket_start(int64_t ts) const;
+        void reduce(const double* vals, size_t count);
+
+        const Func m_func;
+        const int64_t m_interval;
+        const int m_tz_offset;
+
+        // current bucket
+        bool m_open;
+        int64_t m_start;
+        int64_t m_end;
+        size_t m_count;
+        double m_acc;
+
+        std::vector<int64_t> m_ts;
+        std::vector<double> m_vals;
+    };
+};
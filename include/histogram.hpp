@@ -0,0 +1,70 @@
+#pragma once
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "headers.hpp"
+#include <stdint.h>
+
+namespace haystack {
+
+    /**
+     Counter is a 64 bit counter updated with atomic adds.
+     */
+    class Counter : boost::noncopyable
+    {
+    public:
+        Counter() : m_value(0) {}
+
+        void add(uint64_t n = 1);
+        uint64_t value() const;
+
+    private:
+        volatile uint64_t m_value;
+    };
+
+    /**
+     Histogram records the distribution of positive values, such as
+     latencies in microseconds, in log-linear buckets.
+
+     Values below 16 have a bucket each, larger values share a bucket with
+     the values of the same power of two and the same 3 bits below the
+     highest one, so a bucket is at most 12.5% wide. Recording is one
+     atomic add on the bucket and on the sum, without locks. Readers see
+     the buckets as they are, not an atomic snapshot.
+     */
+    class Histogram : boost::noncopyable
+    {
+    public:
+        enum { SUB_BITS = 3, LINEAR = 2 << SUB_BITS, BUCKETS = LINEAR + (64 - SUB_BITS - 1) * (1 << SUB_BITS) };
+
+        Histogram();
+
+        void record(uint64_t value);
+
+        uint64_t count() const;
+        uint64_t sum() const { return m_sum.value(); }
+        uint64_t max() const;
+
+        /**
+        Upper bound of the bucket holding the value at quantile q of
+        0.0 - 1.0, no more than max(). 0 if there are no values.
+        */
+        uint64_t percentile(double q) const;
+
+        /**
+        Bucket of value and its bounds
+        */
+        static size_t bucket(uint64_t value);
+        static uint64_t lower_bound(size_t bucket);
+        static uint64_t upper_bound(size_t bucket);
+
+    private:
+        volatile uint64_t m_buckets[BUCKETS];
+        Counter m_sum;
+        volatile uint64_t m_max;
+    };
+};
@@ -10,6 +10,7 @@
 
 #include "val.hpp"
 #include <stdexcept>
+#include <stdint.h>
 
 namespace haystack {
     /**
@@ -67,6 +68,12 @@ namespace haystack {
         bool operator < (const Val &other) const;
         auto_ptr_t clone() const;
         
+        /**
+        Duration in millis of a number with a time unit, ms, s, sec,
+        min, h, hr, day or wk. Throw runtime_error for any other unit.
+        */
+        int64_t millis() const;
+
         /**
         check if str is a valid unit name
         */
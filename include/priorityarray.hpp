@@ -0,0 +1,129 @@
+#pragma once
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "headers.hpp"
+#include "val.hpp"
+#include "timerwheel.hpp"
+#include <boost/shared_ptr.hpp>
+#include <stdint.h>
+
+namespace haystack {
+    class Grid;
+    class Num;
+
+    /**
+     PriorityArray is the 17 level write array of a writable point.
+
+     Level 1 has the highest priority and level 17 is the default. The
+     effective value is the value of the highest priority level set and is
+     found with a single bit scan of the set levels. Each level is a
+     TimerWheel entry so timed writes can be expired by a wheel.
+     The class is not thread safe.
+
+     @see <a href='http://project-haystack.org/doc/Ops#pointWrite'>Project Haystack</a>
+     */
+    class PriorityArray : boost::noncopyable
+    {
+    public:
+        enum { LEVELS = 17 };
+
+        /**
+        Wheel entry of one level
+        */
+        class Slot : public TimerWheel::Entry
+        {
+        public:
+            Slot() : m_array(NULL), m_level(0), m_duration(0) {}
+            PriorityArray& array() const { return *m_array; }
+            int level() const { return m_level; }
+            // millis of the last timed write, 0 if the level is permanent
+            int64_t duration() const { return m_duration; }
+        private:
+            friend class PriorityArray;
+            PriorityArray* m_array;
+            int m_level;
+            int64_t m_duration;
+        };
+
+        /**
+        Construct with the id of the point owning the array
+        */
+        PriorityArray(const std::string& id = "");
+
+        const std::string& id() const { return m_id; }
+
+        /**
+        Write val at level 1-17, an empty val releases the level.
+        Return true if the effective value changed.
+        */
+        bool write(int level, const Val& val, const std::string& who);
+
+        /**
+        Write val at level for dur, a positive duration with a time unit,
+        or permanently if dur is NULL or not positive. level and dur are
+        checked before the array is changed. The duration is kept in the
+        slot of the level.
+        Return true if the effective value changed.
+        */
+        bool write(int level, const Val& val, const std::string& who, const Num* dur);
+
+        /**
+        Release the level, return true if the effective value changed.
+        */
+        bool release(int level);
+
+        /**
+        Effective level, 0 if no level is set
+        */
+        int level() const;
+
+        /**
+        Effective value, NULL if no level is set
+        */
+        const Val* val() const;
+
+        /**
+        Value and who of a level, NULL and "" if not set
+        */
+        const Val* val(int level) const;
+        const std::string& who(int level) const;
+
+        /**
+        Wheel entry used to expire a timed write at level
+        */
+        Slot& slot(int level);
+
+        /**
+        Grid of the 17 levels with level, levelDis, val and who columns.
+        The grid is shared and only rebuilt after a change.
+        */
+        boost::shared_ptr<const Grid> grid() const;
+
+        /**
+        Display name of a level
+        */
+        static const std::string level_dis(int level);
+
+        /**
+        Milliseconds of a pointWrite duration, see Num::millis.
+        Throws std::runtime_error for a unit which is not a time unit.
+        */
+        static int64_t duration_millis(const Num& dur);
+
+    private:
+        static void check(int level);
+
+        const std::string m_id;
+        Val::auto_ptr_t m_vals[LEVELS];
+        std::string m_who[LEVELS];
+        Slot m_slots[LEVELS];
+        // bit n set when level n + 1 has a value
+        uint32_t m_set;
+        mutable boost::shared_ptr<const Grid> m_grid;
+    };
+};
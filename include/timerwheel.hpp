@@ -0,0 +1,91 @@
+#pragma once
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "headers.hpp"
+#include <vector>
+#include <stdint.h>
+
+namespace haystack {
+
+    /**
+     TimerWheel is a hashed timing wheel of intrusive entries.
+
+     Scheduling, rescheduling and canceling an entry are O(1), each tick
+     only visits the entries hashed to the current slot. Entries further
+     away than a full turn of the wheel stay in their slot until their
+     deadline comes up. The wheel is not thread safe.
+     */
+    class TimerWheel : boost::noncopyable
+    {
+    public:
+        /**
+        Base of the objects scheduled on the wheel
+        */
+        class Entry : boost::noncopyable
+        {
+        public:
+            Entry() : m_prev(NULL), m_next(NULL), m_deadline(0), m_wheel(NULL) {}
+            virtual ~Entry();
+
+            bool is_scheduled() const { return m_wheel != NULL; }
+
+            /**
+            Tick at which the entry expires
+            */
+            uint64_t deadline() const { return m_deadline; }
+
+        private:
+            friend class TimerWheel;
+            Entry* m_prev;
+            Entry* m_next;
+            uint64_t m_deadline;
+            TimerWheel* m_wheel;
+        };
+
+        /**
+        Construct with the number of slots, rounded up to a power of two
+        */
+        TimerWheel(size_t slots = 512);
+        ~TimerWheel();
+
+        /**
+        Current tick
+        */
+        uint64_t now() const { return m_now; }
+
+        /**
+        Number of scheduled entries
+        */
+        size_t size() const { return m_size; }
+
+        /**
+        Schedule or reschedule the entry to expire after the given number
+        of ticks, 0 expires it on the next tick.
+        */
+        void schedule(Entry& e, uint64_t ticks);
+
+        /**
+        Remove the entry from the wheel, no-op if not scheduled
+        */
+        void cancel(Entry& e);
+
+        /**
+        Advance one tick and append the entries that expired to expired,
+        they are no longer scheduled.
+        */
+        void tick(std::vector<Entry*>& expired);
+
+    private:
+        void link(Entry& e);
+
+        std::vector<Entry*> m_slots;
+        size_t m_mask;
+        uint64_t m_now;
+        size_t m_size;
+    };
+};
@@ -0,0 +1,100 @@
+#pragma once
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+
+#include "headers.hpp"
+#include <ostream>
+#include <vector>
+#include <stdint.h>
+
+// Instrumentation points compile to nothing unless HAYSTACK_TRACE is defined
+#ifdef HAYSTACK_TRACE
+#define HAYSTACK_TRACE_SPAN(var, name) haystack::Trace::Span var(name)
+#define HAYSTACK_TRACE_DETAIL(var, text) var.detail(text)
+#define HAYSTACK_TRACE_ARG(var, name, value) var.arg(name, (int64_t)(value))
+#define HAYSTACK_TRACE_HOP() haystack::Trace::add_hop()
+#else
+#define HAYSTACK_TRACE_SPAN(var, name)
+#define HAYSTACK_TRACE_DETAIL(var, text)
+#define HAYSTACK_TRACE_ARG(var, name, value)
+#define HAYSTACK_TRACE_HOP()
+#endif
+
+namespace haystack {
+
+    /**
+     Trace records spans of the hot paths in per thread ring buffers.
+
+     A thread only writes its own ring, without locks, and overwrites its
+     oldest spans once the ring is full. Readers copy the rings and skip
+     the spans overwritten while they copied. Rings are kept after their
+     thread exits, so the spans of pooled threads remain visible.
+
+     Instrument code with the HAYSTACK_TRACE_* macros, they compile to
+     nothing unless HAYSTACK_TRACE is defined.
+     */
+    class Trace : boost::noncopyable
+    {
+    public:
+        enum { RING_SIZE = 2048, MAX_ARGS = 3, MAX_DETAIL = 64 };
+
+        /**
+        A finished span, times in microseconds of a monotonic clock
+        */
+        struct Event
+        {
+            const char* name;
+            char detail[MAX_DETAIL];
+            uint32_t thread;
+            uint64_t start;
+            uint64_t duration;
+            const char* arg_names[MAX_ARGS];
+            int64_t arg_values[MAX_ARGS];
+            size_t num_args;
+        };
+
+        /**
+        Span records the time from its construction to its destruction
+        in the ring of the current thread. name and arg names must be
+        string literals, the detail is copied and cut to MAX_DETAIL - 1.
+        */
+        class Span : boost::noncopyable
+        {
+        public:
+            Span(const char* name);
+            ~Span();
+
+            void detail(const std::string& detail);
+            void arg(const char* name, int64_t value);
+
+        private:
+            Event m_event;
+            uint64_t m_hops;
+        };
+
+        /**
+        Count a ref followed by a filter path, reported as the refHops
+        arg of the enclosing spans
+        */
+        static void add_hop();
+
+        /**
+        Copy the spans of all threads, ordered by start
+        */
+        static void snapshot(std::vector<Event>& events);
+
+        /**
+        Write the spans in the Chrome trace event JSON format
+        */
+        static void write_json(std::ostream& os);
+
+        /**
+        Microseconds of the monotonic clock
+        */
+        static uint64_t now();
+    };
+};
@@ -18,33 +18,56 @@
 ////////////////////////////////////////////////
 using namespace haystack;
 
-// make from time_t
+// days since 1970-01-01 for a proleptic Gregorian civil date
+static int64_t days_from_civil(int y, int m, int d)
+{
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const int64_t yoe = y - era * 400;
+    const int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// civil date for a number of days since 1970-01-01
+static Date civil_from_days(int64_t z)
+{
+    z += 719468;
+    const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+    const int64_t doe = z - era * 146097;
+    const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const int64_t mp = (5 * doy + 2) / 153;
+    const int d = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+    const int m = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+    const int y = static_cast<int>(yoe + era * 400 + (m <= 2));
+    return Date(y, m, d);
+}
+
+// make from millis
 DateTime DateTime::make(const int64_t& ts, const TimeZone& tz)
 {
-    time_t t = ts;
-    int ms = 0;
-    if (ts > (time_t)std::numeric_limits<time_t>::max)
-    {
-        ms = ts % 1000LL;
-        t = static_cast<time_t>(ts / 1000LL);
-    }
+    return make(ts, tz, tz.offset * 3600);
+}
 
-    const std::tm *tm = std::localtime(&t);
-    int tz_offset = 0;
-    if (tz != TimeZone::DEFAULT)
-    {
-        tm = std::gmtime(&t);
-        tz_offset = tz.offset;
-    }
-    else
+// make from millis with an explicit offset
+DateTime DateTime::make(const int64_t& ts, const TimeZone& tz, int tz_offset)
+{
+    const int64_t local = ts + tz_offset * 1000LL;
+    int64_t days = local / 86400000LL;
+    int64_t rem = local % 86400000LL;
+    if (rem < 0)
     {
-        tz_offset = 0;
+        rem += 86400000LL;
+        --days;
     }
 
+    const int ms = static_cast<int>(rem % 1000);
+    const int secs = static_cast<int>(rem / 1000);
 
-    int offset = 3600 * (tz.offset + tm->tm_isdst);
-
-    return DateTime(Date(1900 + tm->tm_year, tm->tm_mon + 1, tm->tm_mday), Time(tm->tm_hour + tz_offset, tm->tm_min, tm->tm_sec, ms), tz, offset);
+    DateTime dt(civil_from_days(days), Time(secs / 3600, (secs % 3600) / 60, secs % 60, ms), tz, tz_offset);
+    dt.m_millis = ts;
+    return dt;
 }
 
 DateTime DateTime::make_time_t(const time_t& ts, const TimeZone& tz)
@@ -141,9 +164,9 @@ const int64_t DateTime::millis() const
     if (m_millis > 0)
         return m_millis;
     // lazy init millis
-    std::tm tm = { time.sec /*sec*/, time.minutes /*min*/, time.hour + TimeZone::DEFAULT.offset /*hr*/, date.day, date.month - 1, date.year - 1900 };
-    std::time_t t = std::mktime(&tm);
-    const_cast<DateTime*>(this)->m_millis = static_cast<int64_t>((t + std::abs(tz_offset)) * 1000ULL + time.ms);
+    const int64_t secs = days_from_civil(date.year, date.month, date.day) * 86400LL
+        + time.hour * 3600 + time.minutes * 60 + time.sec - tz_offset;
+    const_cast<DateTime*>(this)->m_millis = secs * 1000LL + time.ms;
     return m_millis;
 }
 
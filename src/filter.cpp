@@ -11,6 +11,7 @@
 #include "ref.hpp"
 #include "dict.hpp"
 #include "zincreader.hpp"
+#include "trace.hpp"
 
 #include <stdexcept>
 #include <sstream>
@@ -180,6 +181,7 @@ bool PathFilter::include(const Dict& dict, const Pather& pather) const
         for (size_t i = 1; i < m_path->size(); ++i)
         {
             if (val->type() != Val::REF_TYPE) { return do_include(EmptyVal::DEF); }
+            HAYSTACK_TRACE_HOP();
             Dict& nt = (Dict&)pather.find(((Ref&)*val).value);
 
             if (nt.size() == 0) { return do_include(EmptyVal::DEF); }
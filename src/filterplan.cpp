@@ -0,0 +1,289 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+#include "filterplan.hpp"
+#include "dict.hpp"
+#include "num.hpp"
+#include "ref.hpp"
+#include "str.hpp"
+#include <algorithm>
+#include <limits>
+#include <set>
+
+using namespace haystack;
+
+namespace
+{
+    // operand with the estimated cost to evaluate it per decided record
+    struct Operand
+    {
+        Filter::shared_ptr_t filter;
+        double rank;
+        bool operator<(const Operand& other) const { return rank < other.rank; }
+    };
+
+    Filter::shared_ptr_t shared(const Filter& f)
+    {
+        return boost::const_pointer_cast<Filter>(f.shared_from_this());
+    }
+
+    // operands of the nested compounds of one kind, left to right
+    void flatten(const Filter& f, bool is_and, std::vector<Filter::shared_ptr_t>& acc)
+    {
+        const CompoundFilter* c = dynamic_cast<const CompoundFilter*>(&f);
+        if (c != NULL && (dynamic_cast<const And*>(c) != NULL) == is_and)
+        {
+            flatten(c->a(), is_and, acc);
+            flatten(c->b(), is_and, acc);
+        }
+        else
+            acc.push_back(shared(f));
+    }
+}
+
+////////////////////////////////////////////////
+// TagStats
+////////////////////////////////////////////////
+
+const double TagStats::EQ_SELECTIVITY = 0.1;
+const double TagStats::NE_SELECTIVITY = 0.9;
+const double TagStats::RANGE_SELECTIVITY = 0.33;
+const double TagStats::HOP_COST = 10.0;
+
+void TagStats::add(const Dict& rec)
+{
+    ++m_total;
+    for (Dict::const_iterator it = rec.begin(), e = rec.end(); it != e; ++it)
+        ++m_counts[it->first];
+}
+
+size_t TagStats::count(const std::string& tag) const
+{
+    std::map<std::string, size_t>::const_iterator it = m_counts.find(tag);
+    return it != m_counts.end() ? it->second : 0;
+}
+
+double TagStats::frequency(const std::string& tag) const
+{
+    if (m_total == 0)
+        return 1.0;
+    return (double)count(tag) / m_total;
+}
+
+double TagStats::has_selectivity(const Path& path) const
+{
+    double s = 1.0;
+    for (size_t i = 0; i < path.size(); ++i)
+        s *= frequency(path.get(i));
+    return s;
+}
+
+double TagStats::selectivity(const Filter& f) const
+{
+    if (const CompoundFilter* c = dynamic_cast<const CompoundFilter*>(&f))
+    {
+        const double a = selectivity(c->a());
+        const double b = selectivity(c->b());
+        return dynamic_cast<const And*>(c) != NULL ? a * b : a + b - a * b;
+    }
+
+    const PathFilter* p = dynamic_cast<const PathFilter*>(&f);
+    if (p == NULL)
+        return 1.0;
+
+    const double has = has_selectivity(*p->path());
+    if (dynamic_cast<const Has*>(p) != NULL)
+        return has;
+    if (dynamic_cast<const Missing*>(p) != NULL)
+        return 1.0 - has;
+
+    const CmpFilter& cmp = static_cast<const CmpFilter&>(*p);
+    const std::string op = cmp.cmp_str();
+    if (op == "==")
+    {
+        // ids are unique
+        if (p->path()->size() == 1 && p->path()->get(0) == "id" && m_total > 0)
+            return 1.0 / m_total;
+        return has * EQ_SELECTIVITY;
+    }
+    if (op == "!=")
+        return has * NE_SELECTIVITY;
+    return has * RANGE_SELECTIVITY;
+}
+
+double TagStats::cost(const Filter& f) const
+{
+    if (const CompoundFilter* c = dynamic_cast<const CompoundFilter*>(&f))
+    {
+        // the second operand runs when the first did not decide
+        const double a = selectivity(c->a());
+        const double run_b = dynamic_cast<const And*>(c) != NULL ? a : 1.0 - a;
+        return cost(c->a()) + run_b * cost(c->b());
+    }
+
+    const PathFilter* p = dynamic_cast<const PathFilter*>(&f);
+    if (p == NULL)
+        return 1.0;
+
+    // one lookup per tag, a record lookup per ref followed and a compare
+    const size_t size = p->path()->size();
+    double c = (double)size + HOP_COST * (size - 1);
+    if (dynamic_cast<const CmpFilter*>(p) != NULL)
+        c += 1.0;
+    return c;
+}
+
+////////////////////////////////////////////////
+// FilterPlan
+////////////////////////////////////////////////
+
+FilterPlan::FilterPlan(Filter::shared_ptr_t filter, const TagStats& stats)
+    : m_original(filter), m_filter(optimize(filter, stats)), m_index_id(index_id(*m_filter))
+{
+    add(*m_filter, 0, stats);
+}
+
+std::string FilterPlan::access() const
+{
+    return m_index_id.empty() ? "scan" : "id index";
+}
+
+bool FilterPlan::include(const Dict& rec, const Pather& pather)
+{
+    return include(0, rec, pather);
+}
+
+bool FilterPlan::include(size_t node, const Dict& rec, const Pather& pather)
+{
+    Node& n = m_nodes[node];
+    ++n.evaluated;
+
+    bool match;
+    if (n.children.empty())
+        match = n.filter->include(rec, pather);
+    else if (n.op == "and")
+        match = include(n.children[0], rec, pather) && include(n.children[1], rec, pather);
+    else
+        match = include(n.children[0], rec, pather) || include(n.children[1], rec, pather);
+
+    if (match)
+        ++m_nodes[node].matched;
+    return match;
+}
+
+size_t FilterPlan::add(const Filter& f, size_t depth, const TagStats& stats)
+{
+    const size_t index = m_nodes.size();
+    m_nodes.push_back(Node());
+    Node& n = m_nodes.back();
+    n.filter = &f;
+    n.depth = depth;
+    n.selectivity = stats.selectivity(f);
+    n.cost = stats.cost(f);
+    n.evaluated = 0;
+    n.matched = 0;
+
+    if (const CompoundFilter* c = dynamic_cast<const CompoundFilter*>(&f))
+    {
+        n.op = c->keyword();
+        // m_nodes grows, so no references across the recursion
+        const size_t a = add(c->a(), depth + 1, stats);
+        const size_t b = add(c->b(), depth + 1, stats);
+        m_nodes[index].children.push_back(a);
+        m_nodes[index].children.push_back(b);
+    }
+    else if (const CmpFilter* cmp = dynamic_cast<const CmpFilter*>(&f))
+        n.op = cmp->cmp_str();
+    else if (dynamic_cast<const Missing*>(&f) != NULL)
+        n.op = "missing";
+    else
+        n.op = "has";
+
+    return index;
+}
+
+Grid::auto_ptr_t FilterPlan::to_grid() const
+{
+    Grid::auto_ptr_t g(new Grid);
+    g->meta().add("filter", m_original->str())
+        .add("optimized", m_filter->str())
+        .add("access", access());
+    g->add_col("depth");
+    g->add_col("op");
+    g->add_col("filter");
+    g->add_col("selectivity");
+    g->add_col("cost");
+    g->add_col("evaluated");
+    g->add_col("matched");
+
+    g->reserve_rows(m_nodes.size());
+    for (std::vector<Node>::const_iterator it = m_nodes.begin(), e = m_nodes.end(); it != e; ++it)
+    {
+        Val* v[7] = {
+            new Num((double)it->depth),
+            new Str(it->op),
+            new Str(it->filter->str()),
+            new Num(it->selectivity),
+            new Num(it->cost),
+            new Num((double)it->evaluated),
+            new Num((double)it->matched) };
+        g->add_row(v, 7);
+    }
+    return g;
+}
+
+std::string FilterPlan::index_id(const Filter& f)
+{
+    if (const And* a = dynamic_cast<const And*>(&f))
+    {
+        const std::string id = index_id(a->a());
+        return id.empty() ? index_id(a->b()) : id;
+    }
+
+    const CmpFilter* cmp = dynamic_cast<const CmpFilter*>(&f);
+    if (cmp != NULL && cmp->cmp_str() == "==" && cmp->path()->size() == 1 && cmp->path()->get(0) == "id"
+        && cmp->val().type() == Val::REF_TYPE)
+        return static_cast<const Ref&>(cmp->val()).value;
+
+    return "";
+}
+
+Filter::shared_ptr_t FilterPlan::optimize(Filter::shared_ptr_t f, const TagStats& stats)
+{
+    const CompoundFilter* c = dynamic_cast<const CompoundFilter*>(f.get());
+    if (c == NULL)
+        return f;
+
+    const bool is_and = dynamic_cast<const And*>(c) != NULL;
+    std::vector<Filter::shared_ptr_t> flat;
+    flatten(*c, is_and, flat);
+
+    // optimize the operands, dropping repeated ones
+    std::vector<Operand> operands;
+    std::set<std::string> seen;
+    for (std::vector<Filter::shared_ptr_t>::const_iterator it = flat.begin(), e = flat.end(); it != e; ++it)
+    {
+        Operand op;
+        op.filter = optimize(*it, stats);
+        if (!seen.insert(op.filter->str()).second)
+            continue;
+
+        // and stops at the first operand not matching, or at the first
+        // matching: order by cost per record the operand decides
+        const double s = stats.selectivity(*op.filter);
+        const double decides = is_and ? 1.0 - s : s;
+        const double cost = stats.cost(*op.filter);
+        op.rank = decides > 0.0 ? cost / decides : std::numeric_limits<double>::max();
+        operands.push_back(op);
+    }
+    std::stable_sort(operands.begin(), operands.end());
+
+    // rebuild right nested, the first operand evaluated first
+    Filter::shared_ptr_t result = operands.back().filter;
+    for (size_t i = operands.size() - 1; i-- > 0;)
+        result = is_and ? operands[i].filter->AND(result) : operands[i].filter->OR(result);
+    return result;
+}
@@ -0,0 +1,555 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+#include "hischunk.hpp"
+#include "hisitem.hpp"
+#include "datetime.hpp"
+#include "bool.hpp"
+#include "num.hpp"
+#include <algorithm>
+#include <cstring>
+
+using namespace haystack;
+
+//////////////////////////////////////////////////////////////////////////
+// Bit utils
+//////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+    inline int leading_zeros(uint64_t x)
+    {
+#if defined(__GNUC__)
+        return __builtin_clzll(x);
+#else
+        int n = 0;
+        while ((x & 0x8000000000000000ULL) == 0) { x <<= 1; ++n; }
+        return n;
+#endif
+    }
+
+    inline int trailing_zeros(uint64_t x)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctzll(x);
+#else
+        int n = 0;
+        while ((x & 1) == 0) { x >>= 1; ++n; }
+        return n;
+#endif
+    }
+
+    inline uint64_t double_bits(double d)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(bits));
+        return bits;
+    }
+
+    inline double bits_double(uint64_t bits)
+    {
+        double d;
+        std::memcpy(&d, &bits, sizeof(d));
+        return d;
+    }
+
+    inline int64_t sign_extend(uint64_t bits, int n)
+    {
+        const uint64_t sign = 1ULL << (n - 1);
+        return static_cast<int64_t>((bits ^ sign) - sign);
+    }
+
+    void write_varint(std::vector<uint8_t>& out, uint32_t v)
+    {
+        while (v >= 0x80)
+        {
+            out.push_back(static_cast<uint8_t>(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(v));
+    }
+
+    uint32_t read_varint(const std::vector<uint8_t>& in, size_t& pos)
+    {
+        uint32_t v = 0;
+        for (int shift = 0;; shift += 7)
+        {
+            const uint8_t b = in[pos++];
+            v |= static_cast<uint32_t>(b & 0x7F) << shift;
+            if ((b & 0x80) == 0)
+                return v;
+        }
+    }
+
+    // MSB first reader over the HisChunk bit stream, buffers up to 64 bits
+    class BitReader
+    {
+    public:
+        BitReader(const std::vector<uint8_t>& data) :
+            m_data(data.empty() ? NULL : &data[0]), m_size(data.size()), m_pos(0), m_buf(0), m_avail(0) {}
+
+        bool read_bit()
+        {
+            return read(1) != 0;
+        }
+
+        uint64_t read(int n)
+        {
+            if (n > 32)
+            {
+                const uint64_t hi = read(n - 32);
+                return (hi << 32) | read(32);
+            }
+            if (m_avail < n)
+                refill();
+            m_avail -= n;
+            return (m_buf >> m_avail) & ((1ULL << n) - 1);
+        }
+
+    private:
+        void refill()
+        {
+            while (m_avail <= 56)
+            {
+                m_buf = (m_buf << 8) | (m_pos < m_size ? m_data[m_pos] : 0);
+                ++m_pos;
+                m_avail += 8;
+            }
+        }
+
+        const uint8_t* m_data;
+        const size_t m_size;
+        size_t m_pos;
+        uint64_t m_buf;
+        int m_avail;
+    };
+}
+
+//////////////////////////////////////////////////////////////////////////
+// HisChunk
+//////////////////////////////////////////////////////////////////////////
+
+HisChunk::HisChunk(Kind kind, int tz_offset) :
+m_kind(kind),
+m_tz_offset(tz_offset),
+m_count(0),
+m_bit_len(0),
+m_first_ts(0),
+m_last_ts(0),
+m_last_delta(0),
+m_last_val(0),
+m_leading(-1),
+m_trailing(0),
+m_first_bool(false),
+m_run_val(false),
+m_run_len(0) {}
+
+size_t HisChunk::byte_size() const
+{
+    return sizeof(*this) + m_bits.capacity() + m_runs.capacity();
+}
+
+bool HisChunk::append(int64_t ts, double val)
+{
+    if (is_full() || (m_count > 0 && ts <= m_last_ts))
+        return false;
+
+    write_ts(ts);
+    if (m_kind == BOOL_KIND)
+        write_bool(val != 0.0);
+    else
+        write_num(val);
+
+    ++m_count;
+    return true;
+}
+
+void HisChunk::seal()
+{
+    std::vector<uint8_t>(m_bits).swap(m_bits);
+    std::vector<uint8_t>(m_runs).swap(m_runs);
+}
+
+void HisChunk::write_bits(uint64_t bits, int n)
+{
+    while (n > 0)
+    {
+        const int bit = static_cast<int>(m_bit_len & 7);
+        if (bit == 0)
+            m_bits.push_back(0);
+
+        const int room = 8 - bit;
+        const int take = n < room ? n : room;
+        const uint8_t part = static_cast<uint8_t>((bits >> (n - take)) & ((1u << take) - 1));
+        m_bits.back() |= static_cast<uint8_t>(part << (room - take));
+        m_bit_len += take;
+        n -= take;
+    }
+}
+
+// delta-of-delta encoding with variable width buckets:
+//   '0'                dod == 0
+//   '10'   + 7 bits    [-64, 63]
+//   '110'  + 12 bits   [-2048, 2047]
+//   '1110' + 20 bits   [-524288, 524287]
+//   '1111' + 64 bits   any other value
+void HisChunk::write_ts(int64_t ts)
+{
+    if (m_count == 0)
+    {
+        m_first_ts = ts;
+        m_last_ts = ts;
+        m_last_delta = 0;
+        return;
+    }
+
+    const int64_t delta = ts - m_last_ts;
+    const int64_t dod = delta - m_last_delta;
+
+    if (dod == 0)
+    {
+        write_bits(0, 1);
+    }
+    else if (dod >= -64 && dod < 64)
+    {
+        write_bits(2, 2);
+        write_bits(static_cast<uint64_t>(dod), 7);
+    }
+    else if (dod >= -2048 && dod < 2048)
+    {
+        write_bits(6, 3);
+        write_bits(static_cast<uint64_t>(dod), 12);
+    }
+    else if (dod >= -524288 && dod < 524288)
+    {
+        write_bits(14, 4);
+        write_bits(static_cast<uint64_t>(dod), 20);
+    }
+    else
+    {
+        write_bits(15, 4);
+        write_bits(static_cast<uint64_t>(dod), 64);
+    }
+
+    m_last_delta = delta;
+    m_last_ts = ts;
+}
+
+// XOR encoding against the previous value:
+//   '0'                              same value
+//   '10' + meaningful bits           xor fits the previous leading/trailing window
+//   '11' + 5 bits leading + 6 bits length + meaningful bits
+void HisChunk::write_num(double val)
+{
+    const uint64_t bits = double_bits(val);
+
+    if (m_count == 0)
+    {
+        write_bits(bits, 64);
+        m_last_val = bits;
+        return;
+    }
+
+    const uint64_t x = bits ^ m_last_val;
+    m_last_val = bits;
+
+    if (x == 0)
+    {
+        write_bits(0, 1);
+        return;
+    }
+
+    int leading = leading_zeros(x);
+    const int trailing = trailing_zeros(x);
+    if (leading > 31) leading = 31;
+
+    if (m_leading >= 0 && leading >= m_leading && trailing >= m_trailing)
+    {
+        write_bits(2, 2);
+        write_bits(x >> m_trailing, 64 - m_leading - m_trailing);
+    }
+    else
+    {
+        const int len = 64 - leading - trailing;
+        write_bits(3, 2);
+        write_bits(static_cast<uint64_t>(leading), 5);
+        write_bits(static_cast<uint64_t>(len - 1), 6);
+        write_bits(x >> trailing, len);
+        m_leading = leading;
+        m_trailing = trailing;
+    }
+}
+
+// run-length encoding, only closed runs are written out
+void HisChunk::write_bool(bool val)
+{
+    if (m_count == 0)
+    {
+        m_first_bool = val;
+        m_run_val = val;
+        m_run_len = 1;
+        return;
+    }
+
+    if (val == m_run_val)
+    {
+        ++m_run_len;
+        return;
+    }
+
+    write_varint(m_runs, m_run_len);
+    m_run_val = val;
+    m_run_len = 1;
+}
+
+void HisChunk::decode(std::vector<int64_t>& ts, std::vector<double>& vals) const
+{
+    if (m_count == 0)
+        return;
+
+    ts.reserve(ts.size() + m_count);
+    vals.reserve(vals.size() + m_count);
+
+    BitReader r(m_bits);
+    int64_t t = m_first_ts;
+    int64_t delta = 0;
+
+    // Number state
+    uint64_t v = 0;
+    int leading = 0;
+    int trailing = 0;
+
+    // Bool state
+    size_t run_pos = 0;
+    bool cur = m_first_bool;
+    uint32_t left = m_runs.empty() ? m_run_len : read_varint(m_runs, run_pos);
+
+    for (size_t i = 0; i < m_count; ++i)
+    {
+        if (i > 0)
+        {
+            if (r.read_bit())
+            {
+                int64_t dod;
+                if (!r.read_bit()) dod = sign_extend(r.read(7), 7);
+                else if (!r.read_bit()) dod = sign_extend(r.read(12), 12);
+                else if (!r.read_bit()) dod = sign_extend(r.read(20), 20);
+                else dod = static_cast<int64_t>(r.read(64));
+                delta += dod;
+            }
+            t += delta;
+        }
+        ts.push_back(t);
+
+        if (m_kind == BOOL_KIND)
+        {
+            if (left == 0)
+            {
+                cur = !cur;
+                left = run_pos < m_runs.size() ? read_varint(m_runs, run_pos) : m_run_len;
+            }
+            --left;
+            vals.push_back(cur ? 1.0 : 0.0);
+            continue;
+        }
+
+        if (i == 0)
+        {
+            v = r.read(64);
+        }
+        else if (r.read_bit())
+        {
+            if (r.read_bit())
+            {
+                leading = static_cast<int>(r.read(5));
+                const int len = static_cast<int>(r.read(6)) + 1;
+                trailing = 64 - leading - len;
+            }
+            v ^= r.read(64 - leading - trailing) << trailing;
+        }
+        vals.push_back(bits_double(v));
+    }
+}
+
+void HisChunk::decode(std::vector<Sample>& samples) const
+{
+    std::vector<int64_t> ts;
+    std::vector<double> vals;
+    decode(ts, vals);
+
+    samples.reserve(samples.size() + ts.size());
+    for (size_t i = 0; i < ts.size(); ++i)
+        samples.push_back(Sample(ts[i], vals[i], m_tz_offset));
+}
+
+//////////////////////////////////////////////////////////////////////////
+// HisSeries
+//////////////////////////////////////////////////////////////////////////
+
+HisSeries::HisSeries(HisChunk::Kind kind, const std::string& unit) : m_kind(kind), m_unit(unit), m_count(0) {}
+
+size_t HisSeries::byte_size() const
+{
+    size_t size = sizeof(*this) + m_chunks.size() * sizeof(HisChunk*);
+    for (chunks_t::const_iterator it = m_chunks.begin(), e = m_chunks.end(); it != e; ++it)
+        size += it->byte_size();
+    return size;
+}
+
+int64_t HisSeries::first_ts() const
+{
+    return m_chunks.empty() ? 0 : m_chunks.front().first_ts();
+}
+
+int64_t HisSeries::last_ts() const
+{
+    return m_chunks.empty() ? 0 : m_chunks.back().last_ts();
+}
+
+void HisSeries::append(int64_t ts, double val, int tz_offset)
+{
+    HisChunk::Sample s(ts, val, tz_offset);
+
+    if (m_chunks.empty() || ts > last_ts())
+    {
+        push(s);
+        return;
+    }
+
+    std::vector<HisChunk::Sample> v(1, s);
+    merge(v);
+}
+
+void HisSeries::merge(std::vector<HisChunk::Sample>& samples)
+{
+    if (samples.empty())
+        return;
+
+    // sort and drop duplicates, the last written sample wins
+    std::stable_sort(samples.begin(), samples.end());
+    std::vector<HisChunk::Sample> in;
+    in.reserve(samples.size());
+    for (std::vector<HisChunk::Sample>::const_iterator it = samples.begin(), e = samples.end(); it != e; ++it)
+    {
+        if (!in.empty() && in.back().ts == it->ts)
+            in.back() = *it;
+        else
+            in.push_back(*it);
+    }
+
+    // fast path, everything goes after the last sample
+    if (m_chunks.empty() || in.front().ts > last_ts())
+    {
+        for (std::vector<HisChunk::Sample>::const_iterator it = in.begin(), e = in.end(); it != e; ++it)
+            push(*it);
+        return;
+    }
+
+    // decode the tail affected by the merge and re-encode it
+    const size_t first = find_chunk(in.front().ts);
+    std::vector<HisChunk::Sample> tail;
+    for (size_t i = first; i < m_chunks.size(); ++i)
+        m_chunks[i].decode(tail);
+
+    m_count -= tail.size();
+    m_chunks.erase(m_chunks.begin() + first, m_chunks.end());
+
+    std::vector<HisChunk::Sample>::const_iterator a = tail.begin(), ae = tail.end();
+    std::vector<HisChunk::Sample>::const_iterator b = in.begin(), be = in.end();
+    while (a != ae || b != be)
+    {
+        if (b == be || (a != ae && a->ts < b->ts))
+        {
+            push(*a++);
+        }
+        else
+        {
+            // new sample replaces a stored one with the same timestamp
+            if (a != ae && a->ts == b->ts) ++a;
+            push(*b++);
+        }
+    }
+}
+
+void HisSeries::read(int64_t start, int64_t end, std::vector<int64_t>& ts, std::vector<double>& vals) const
+{
+    const size_t base = ts.size();
+
+    for (size_t i = find_chunk(start + 1); i < m_chunks.size(); ++i)
+    {
+        const HisChunk& c = m_chunks[i];
+        if (c.first_ts() > end)
+            break;
+        c.decode(ts, vals);
+    }
+
+    // trim samples outside of the range from the first and last chunk
+    std::vector<int64_t>::iterator lo = std::upper_bound(ts.begin() + base, ts.end(), start);
+    std::vector<int64_t>::iterator hi = std::upper_bound(lo, ts.end(), end);
+
+    const size_t lo_idx = lo - ts.begin();
+    const size_t hi_idx = hi - ts.begin();
+
+    ts.erase(hi, ts.end());
+    vals.erase(vals.begin() + hi_idx, vals.end());
+    ts.erase(ts.begin() + base, ts.begin() + lo_idx);
+    vals.erase(vals.begin() + base, vals.begin() + lo_idx);
+}
+
+void HisSeries::read(int64_t start, int64_t end, const TimeZone& tz, std::vector<HisItem>& items) const
+{
+    std::vector<HisChunk::Sample> samples;
+
+    for (size_t i = find_chunk(start + 1); i < m_chunks.size(); ++i)
+    {
+        const HisChunk& c = m_chunks[i];
+        if (c.first_ts() > end)
+            break;
+        c.decode(samples);
+    }
+
+    items.reserve(items.size() + samples.size());
+    for (std::vector<HisChunk::Sample>::const_iterator it = samples.begin(), e = samples.end(); it != e; ++it)
+    {
+        if (it->ts <= start || it->ts > end)
+            continue;
+
+        boost::shared_ptr<const DateTime> ts((DateTime*)DateTime::make(it->ts, tz, it->tz_offset).clone().release());
+        boost::shared_ptr<const Val> val(m_kind == HisChunk::BOOL_KIND ?
+            Bool(it->val != 0.0).clone().release() :
+            Num(it->val, m_unit).clone().release());
+
+        items.push_back(HisItem(ts, val));
+    }
+}
+
+size_t HisSeries::find_chunk(int64_t ts) const
+{
+    // chunks are ordered and don't overlap, binary search on the last timestamp
+    size_t lo = 0, hi = m_chunks.size();
+    while (lo < hi)
+    {
+        const size_t mid = (lo + hi) / 2;
+        if (m_chunks[mid].last_ts() < ts)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+void HisSeries::push(const HisChunk::Sample& s)
+{
+    if (m_chunks.empty() || m_chunks.back().is_full() || m_chunks.back().tz_offset() != s.tz_offset)
+    {
+        if (!m_chunks.empty())
+            m_chunks.back().seal();
+        m_chunks.push_back(new HisChunk(m_kind, s.tz_offset));
+    }
+
+    m_chunks.back().append(s.ts, s.val);
+    ++m_count;
+}
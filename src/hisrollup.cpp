@@ -0,0 +1,166 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+#include "hisrollup.hpp"
+#include "num.hpp"
+#include <stdexcept>
+
+using namespace haystack;
+
+////////////////////////////////////////////////
+// HisRollup
+////////////////////////////////////////////////
+
+HisRollup::Func HisRollup::parse(const std::string& name)
+{
+    if (name == "avg") return AVG;
+    if (name == "min") return MIN;
+    if (name == "max") return MAX;
+    if (name == "sum") return SUM;
+    if (name == "count") return COUNT;
+    if (name == "first") return FIRST;
+    if (name == "last") return LAST;
+    throw std::runtime_error("Unknown rollup: " + name);
+}
+
+const std::string HisRollup::name(Func func)
+{
+    switch (func)
+    {
+    case AVG: return "avg";
+    case MIN: return "min";
+    case MAX: return "max";
+    case SUM: return "sum";
+    case COUNT: return "count";
+    case FIRST: return "first";
+    case LAST: return "last";
+    }
+    return "";
+}
+
+int64_t HisRollup::interval_millis(const Num& interval)
+{
+    const int64_t millis = interval.millis();
+    if (millis <= 0)
+        throw std::runtime_error("Invalid interval: " + interval.to_zinc());
+    return millis;
+}
+
+HisRollup::HisRollup(Func func, int64_t interval, int tz_offset) :
+m_func(func),
+m_interval(interval),
+m_tz_offset(tz_offset),
+m_open(false),
+m_start(0),
+m_end(0),
+m_count(0),
+m_acc(0.0)
+{
+    if (interval <= 0)
+        throw std::runtime_error("Invalid rollup interval");
+}
+
+void HisRollup::add(int64_t ts, double val)
+{
+    add(&ts, &val, 1);
+}
+
+void HisRollup::add(const std::vector<int64_t>& ts, const std::vector<double>& vals)
+{
+    if (ts.empty())
+        return;
+    add(&ts[0], &vals[0], ts.size());
+}
+
+void HisRollup::add(const int64_t* ts, const double* vals, size_t count)
+{
+    size_t i = 0;
+    while (i < count)
+    {
+        if (!m_open || ts[i] >= m_end)
+        {
+            finish();
+            m_start = bucket_start(ts[i]);
+            m_end = m_start + m_interval;
+            m_open = true;
+        }
+
+        // length of the run that falls in the current bucket
+        size_t j = i + 1;
+        while (j < count && ts[j] < m_end)
+            ++j;
+
+        reduce(vals + i, j - i);
+        i = j;
+    }
+}
+
+void HisRollup::finish()
+{
+    if (!m_open)
+        return;
+
+    double v = m_acc;
+    if (m_func == AVG) v = m_acc / m_count;
+    else if (m_func == COUNT) v = static_cast<double>(m_count);
+
+    m_ts.push_back(m_start);
+    m_vals.push_back(v);
+
+    m_open = false;
+    m_count = 0;
+    m_acc = 0.0;
+}
+
+int64_t HisRollup::bucket_start(int64_t ts) const
+{
+    const int64_t local = ts + m_tz_offset * 1000LL;
+    int64_t b = local / m_interval;
+    if (local % m_interval < 0) --b;
+    return b * m_interval - m_tz_offset * 1000LL;
+}
+
+// the reductions run over contiguous doubles so they can be auto-vectorised
+void HisRollup::reduce(const double* vals, size_t count)
+{
+    switch (m_func)
+    {
+    case AVG:
+    case SUM:
+    {
+        double acc = 0.0;
+        for (size_t i = 0; i < count; ++i)
+            acc += vals[i];
+        m_acc += acc;
+        break;
+    }
+    case MIN:
+    {
+        double acc = m_count == 0 ? vals[0] : m_acc;
+        for (size_t i = 0; i < count; ++i)
+            acc = vals[i] < acc ? vals[i] : acc;
+        m_acc = acc;
+        break;
+    }
+    case MAX:
+    {
+        double acc = m_count == 0 ? vals[0] : m_acc;
+        for (size_t i = 0; i < count; ++i)
+            acc = vals[i] > acc ? vals[i] : acc;
+        m_acc = acc;
+        break;
+    }
+    case FIRST:
+        if (m_count == 0) m_acc = vals[0];
+        break;
+    case LAST:
+        m_acc = vals[count - 1];
+        break;
+    case COUNT:
+        break;
+    }
+    m_count += count;
+}
@@ -0,0 +1,181 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+#include "histogram.hpp"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace haystack;
+
+namespace
+{
+    inline void atomic_add(volatile uint64_t& v, uint64_t n)
+    {
+#if defined(__GNUC__)
+        __sync_fetch_and_add(&v, n);
+#elif defined(_MSC_VER)
+        _InterlockedExchangeAdd64((volatile __int64*)&v, (__int64)n);
+#else
+        v += n;
+#endif
+    }
+
+    inline uint64_t atomic_load(const volatile uint64_t& v)
+    {
+#if defined(__GNUC__)
+        return __sync_fetch_and_add(const_cast<volatile uint64_t*>(&v), 0);
+#elif defined(_MSC_VER)
+        return (uint64_t)_InterlockedCompareExchange64((volatile __int64*)&v, 0, 0);
+#else
+        return v;
+#endif
+    }
+
+    inline void atomic_max(volatile uint64_t& v, uint64_t n)
+    {
+#if defined(__GNUC__)
+        uint64_t cur = v;
+        while (n > cur)
+        {
+            const uint64_t prev = __sync_val_compare_and_swap(&v, cur, n);
+            if (prev == cur)
+                break;
+            cur = prev;
+        }
+#elif defined(_MSC_VER)
+        __int64 cur = (__int64)v;
+        while ((__int64)n > cur)
+        {
+            const __int64 prev = _InterlockedCompareExchange64((volatile __int64*)&v, (__int64)n, cur);
+            if (prev == cur)
+                break;
+            cur = prev;
+        }
+#else
+        if (n > v) v = n;
+#endif
+    }
+
+    // index of the highest bit set, value must not be 0
+    inline int highest_bit(uint64_t value)
+    {
+#if defined(__GNUC__)
+        return 63 - __builtin_clzll(value);
+#else
+        int n = 0;
+        while (value >>= 1) ++n;
+        return n;
+#endif
+    }
+}
+
+////////////////////////////////////////////////
+// Counter
+////////////////////////////////////////////////
+
+void Counter::add(uint64_t n)
+{
+    atomic_add(m_value, n);
+}
+
+uint64_t Counter::value() const
+{
+    return atomic_load(m_value);
+}
+
+////////////////////////////////////////////////
+// Histogram
+////////////////////////////////////////////////
+
+Histogram::Histogram() : m_max(0)
+{
+    for (size_t i = 0; i < BUCKETS; ++i)
+        m_buckets[i] = 0;
+}
+
+void Histogram::record(uint64_t value)
+{
+    atomic_add(m_buckets[bucket(value)], 1);
+    m_sum.add(value);
+    atomic_max(m_max, value);
+}
+
+uint64_t Histogram::count() const
+{
+    uint64_t n = 0;
+    for (size_t i = 0; i < BUCKETS; ++i)
+        n += atomic_load(m_buckets[i]);
+    return n;
+}
+
+uint64_t Histogram::max() const
+{
+    return atomic_load(m_max);
+}
+
+uint64_t Histogram::percentile(double q) const
+{
+    uint64_t counts[BUCKETS];
+    uint64_t total = 0;
+    for (size_t i = 0; i < BUCKETS; ++i)
+    {
+        counts[i] = atomic_load(m_buckets[i]);
+        total += counts[i];
+    }
+    if (total == 0)
+        return 0;
+
+    // rank of the value, 1 based
+    q = q < 0.0 ? 0.0 : q > 1.0 ? 1.0 : q;
+    uint64_t rank = (uint64_t)(q * total + 0.5);
+    if (rank == 0)
+        rank = 1;
+
+    const uint64_t top = max();
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            const uint64_t upper = upper_bound(i);
+            return upper < top ? upper : top;
+        }
+    }
+    return top;
+}
+
+size_t Histogram::bucket(uint64_t value)
+{
+    if (value < LINEAR)
+        return (size_t)value;
+
+    const int e = highest_bit(value);
+    const size_t sub = (size_t)(value >> (e - SUB_BITS)) & ((1 << SUB_BITS) - 1);
+    return LINEAR + (size_t)(e - SUB_BITS - 1) * (1 << SUB_BITS) + sub;
+}
+
+uint64_t Histogram::lower_bound(size_t bucket)
+{
+    if (bucket < LINEAR)
+        return bucket;
+
+    const size_t i = bucket - LINEAR;
+    const int e = (int)(i >> SUB_BITS) + SUB_BITS + 1;
+    const uint64_t sub = i & ((1 << SUB_BITS) - 1);
+    return (((uint64_t)1 << SUB_BITS) + sub) << (e - SUB_BITS);
+}
+
+uint64_t Histogram::upper_bound(size_t bucket)
+{
+    if (bucket < LINEAR)
+        return bucket;
+
+    const int e = (int)((bucket - LINEAR) >> SUB_BITS) + SUB_BITS + 1;
+    return lower_bound(bucket) + ((uint64_t)1 << (e - SUB_BITS)) - 1;
+}
@@ -113,6 +113,27 @@ Num::auto_ptr_t Num::clone() const
     return auto_ptr_t(new Num(*this));
 }
 
+int64_t Num::millis() const
+{
+    int64_t scale;
+    if (unit == "ms")
+        scale = 1;
+    else if (unit == "s" || unit == "sec")
+        scale = 1000;
+    else if (unit == "min")
+        scale = 60 * 1000;
+    else if (unit == "h" || unit == "hr")
+        scale = 60 * 60 * 1000;
+    else if (unit == "day")
+        scale = 24 * 60 * 60 * 1000;
+    else if (unit == "wk")
+        scale = (int64_t)7 * 24 * 60 * 60 * 1000;
+    else
+        throw std::runtime_error("Invalid duration unit: " + to_zinc());
+
+    return static_cast<int64_t>(value * scale);
+}
+
 ////////////////////////////////////////////////
 // Static
 ////////////////////////////////////////////////
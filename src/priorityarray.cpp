@@ -0,0 +1,178 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+#include "priorityarray.hpp"
+#include "grid.hpp"
+#include "num.hpp"
+#include "str.hpp"
+#include <boost/lexical_cast.hpp>
+#include <stdexcept>
+
+using namespace haystack;
+
+namespace
+{
+    // index of the lowest bit set, mask must not be 0
+    inline int lowest_bit(uint32_t mask)
+    {
+#if defined(__GNUC__)
+        return __builtin_ctz(mask);
+#else
+        int n = 0;
+        while ((mask & 1) == 0) { mask >>= 1; ++n; }
+        return n;
+#endif
+    }
+}
+
+////////////////////////////////////////////////
+// PriorityArray
+////////////////////////////////////////////////
+
+PriorityArray::PriorityArray(const std::string& id) : m_id(id), m_set(0)
+{
+    for (int i = 0; i < LEVELS; ++i)
+    {
+        m_slots[i].m_array = this;
+        m_slots[i].m_level = i + 1;
+    }
+}
+
+bool PriorityArray::write(int level, const Val& val, const std::string& who)
+{
+    check(level);
+    if (val.is_empty())
+        return release(level);
+
+    const int old = this->level();
+    const int i = level - 1;
+
+    // the value becomes effective, but an equal one is not a change
+    const Val* prev = this->val();
+    const bool changed = (old == 0 || level <= old) && (prev == NULL || !(*prev == val));
+
+    m_vals[i] = val.clone();
+    m_who[i] = who;
+    m_slots[i].m_duration = 0;
+    m_set |= 1u << i;
+    m_grid.reset();
+
+    return changed;
+}
+
+bool PriorityArray::write(int level, const Val& val, const std::string& who, const Num* dur)
+{
+    check(level);
+    const int64_t millis = !val.is_empty() && dur != NULL && dur->value > 0 ? duration_millis(*dur) : 0;
+
+    const bool changed = write(level, val, who);
+    m_slots[level - 1].m_duration = millis;
+    return changed;
+}
+
+bool PriorityArray::release(int level)
+{
+    check(level);
+
+    const int i = level - 1;
+    if ((m_set & (1u << i)) == 0)
+        return false;
+
+    const int old = this->level();
+    const Val::auto_ptr_t prev = m_vals[i];
+    m_who[i].clear();
+    m_slots[i].m_duration = 0;
+    m_set &= ~(1u << i);
+    m_grid.reset();
+
+    if (level != old)
+        return false;
+
+    // the next level may hold an equal value
+    const Val* v = val();
+    return v == NULL || !(*v == *prev);
+}
+
+int PriorityArray::level() const
+{
+    return m_set == 0 ? 0 : lowest_bit(m_set) + 1;
+}
+
+const Val* PriorityArray::val() const
+{
+    return m_set == 0 ? NULL : m_vals[lowest_bit(m_set)].get();
+}
+
+const Val* PriorityArray::val(int level) const
+{
+    check(level);
+    return m_vals[level - 1].get();
+}
+
+const std::string& PriorityArray::who(int level) const
+{
+    check(level);
+    return m_who[level - 1];
+}
+
+PriorityArray::Slot& PriorityArray::slot(int level)
+{
+    check(level);
+    return m_slots[level - 1];
+}
+
+boost::shared_ptr<const Grid> PriorityArray::grid() const
+{
+    if (m_grid.get() != NULL)
+        return m_grid;
+
+    boost::shared_ptr<Grid> g(new Grid);
+    g->add_col("level");
+    g->add_col("levelDis");
+    g->add_col("val");
+    g->add_col("who");
+    g->reserve_rows(LEVELS);
+
+    for (int i = 0; i < LEVELS; ++i)
+    {
+        const bool set = (m_set & (1u << i)) != 0;
+        Val* v[4] = {
+            new Num(i + 1),
+            new Str(level_dis(i + 1)),
+            set ? (Val*)m_vals[i]->clone().release() : NULL,
+            set ? new Str(m_who[i]) : NULL,
+        };
+        g->add_row(v, 4);
+    }
+
+    m_grid = g;
+    return m_grid;
+}
+
+const std::string PriorityArray::level_dis(int level)
+{
+    switch (level)
+    {
+    case 1: return "Manual Life Safety";
+    case 2: return "Automatic Life Safety";
+    case 5: return "Critical Equipment Control";
+    case 6: return "Minimum On/Off";
+    case 8: return "Manual Operator";
+    case 17: return "Default";
+    }
+    return "Level " + boost::lexical_cast<std::string>(level);
+}
+
+int64_t PriorityArray::duration_millis(const Num& dur)
+{
+    return dur.millis();
+}
+
+void PriorityArray::check(int level)
+{
+    if (level < 1 || level > LEVELS)
+        throw std::runtime_error("Invalid level 1-17: " + boost::lexical_cast<std::string>(level));
+}
@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+#include "timerwheel.hpp"
+
+using namespace haystack;
+
+////////////////////////////////////////////////
+// TimerWheel::Entry
+////////////////////////////////////////////////
+
+TimerWheel::Entry::~Entry()
+{
+    if (m_wheel != NULL)
+        m_wheel->cancel(*this);
+}
+
+////////////////////////////////////////////////
+// TimerWheel
+////////////////////////////////////////////////
+
+TimerWheel::TimerWheel(size_t slots) : m_now(0), m_size(0)
+{
+    size_t n = 1;
+    while (n < slots)
+        n <<= 1;
+
+    m_slots.resize(n, NULL);
+    m_mask = n - 1;
+}
+
+TimerWheel::~TimerWheel()
+{
+    // detach the remaining entries
+    for (size_t i = 0; i < m_slots.size(); ++i)
+    {
+        for (Entry* e = m_slots[i]; e != NULL;)
+        {
+            Entry* next = e->m_next;
+            e->m_prev = e->m_next = NULL;
+            e->m_wheel = NULL;
+            e = next;
+        }
+    }
+}
+
+void TimerWheel::schedule(Entry& e, uint64_t ticks)
+{
+    cancel(e);
+    e.m_deadline = m_now + (ticks > 0 ? ticks : 1);
+    link(e);
+}
+
+void TimerWheel::cancel(Entry& e)
+{
+    if (e.m_wheel != this)
+        return;
+
+    if (e.m_prev != NULL)
+        e.m_prev->m_next = e.m_next;
+    else
+        m_slots[e.m_deadline & m_mask] = e.m_next;
+
+    if (e.m_next != NULL)
+        e.m_next->m_prev = e.m_prev;
+
+    e.m_prev = e.m_next = NULL;
+    e.m_wheel = NULL;
+    --m_size;
+}
+
+void TimerWheel::tick(std::vector<Entry*>& expired)
+{
+    ++m_now;
+
+    for (Entry* e = m_slots[m_now & m_mask]; e != NULL;)
+    {
+        Entry* next = e->m_next;
+        // entries a full turn or more away stay in the slot
+        if (e->m_deadline <= m_now)
+        {
+            cancel(*e);
+            expired.push_back(e);
+        }
+        e = next;
+    }
+}
+
+void TimerWheel::link(Entry& e)
+{
+    Entry*& head = m_slots[e.m_deadline & m_mask];
+    e.m_prev = NULL;
+    e.m_next = head;
+    if (head != NULL)
+        head->m_prev = &e;
+    head = &e;
+    e.m_wheel = this;
+    ++m_size;
+}
@@ -0,0 +1,235 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+#include "trace.hpp"
+#include <algorithm>
+#include <string.h>
+#include <stdio.h>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <intrin.h>
+#define HAYSTACK_THREAD_LOCAL __declspec(thread)
+#else
+#include <time.h>
+#define HAYSTACK_THREAD_LOCAL __thread
+#endif
+
+using namespace haystack;
+
+namespace
+{
+    // spans of one thread, only written by it
+    struct Ring
+    {
+        Ring() : head(0), hops(0), thread(0), next(NULL) {}
+        Trace::Event events[Trace::RING_SIZE];
+        volatile uint64_t head;
+        uint64_t hops;
+        uint32_t thread;
+        Ring* next;
+    };
+
+    // rings of all threads, pushed to the front and never removed
+    Ring* volatile g_rings = NULL;
+    volatile long g_threads = 0;
+
+    HAYSTACK_THREAD_LOCAL Ring* t_ring = NULL;
+
+    inline void barrier()
+    {
+#if defined(__GNUC__)
+        __sync_synchronize();
+#elif defined(_MSC_VER)
+        _ReadWriteBarrier();
+        MemoryBarrier();
+#endif
+    }
+
+    Ring& ring()
+    {
+        if (t_ring != NULL)
+            return *t_ring;
+
+        Ring* r = new Ring;
+#if defined(__GNUC__)
+        r->thread = (uint32_t)__sync_add_and_fetch(&g_threads, 1);
+        do
+        {
+            r->next = g_rings;
+        } while (!__sync_bool_compare_and_swap(&g_rings, r->next, r));
+#elif defined(_MSC_VER)
+        r->thread = (uint32_t)_InterlockedIncrement(&g_threads);
+        do
+        {
+            r->next = g_rings;
+        } while (_InterlockedCompareExchangePointer((void* volatile*)&g_rings, r, r->next) != r->next);
+#else
+        r->thread = (uint32_t)++g_threads;
+        r->next = g_rings;
+        g_rings = r;
+#endif
+        t_ring = r;
+        return *r;
+    }
+
+    bool by_start(const Trace::Event& a, const Trace::Event& b)
+    {
+        return a.start < b.start;
+    }
+
+    void write_json_str(std::ostream& os, const char* s)
+    {
+        os << '"';
+        for (; *s != '\0'; ++s)
+        {
+            const unsigned char c = (unsigned char)*s;
+            if (c == '"' || c == '\\')
+                os << '\\' << (char)c;
+            else if (c < 0x20)
+            {
+                char buf[8];
+                sprintf(buf, "\\u%04x", (unsigned)c);
+                os << buf;
+            }
+            else
+                os << (char)c;
+        }
+        os << '"';
+    }
+}
+
+////////////////////////////////////////////////
+// Trace
+////////////////////////////////////////////////
+
+void Trace::add_hop()
+{
+    ++ring().hops;
+}
+
+uint64_t Trace::now()
+{
+#if defined(_WIN32)
+    static LARGE_INTEGER freq;
+    if (freq.QuadPart == 0)
+        QueryPerformanceFrequency(&freq);
+    LARGE_INTEGER t;
+    QueryPerformanceCounter(&t);
+    return (uint64_t)(t.QuadPart / freq.QuadPart * 1000000 + t.QuadPart % freq.QuadPart * 1000000 / freq.QuadPart);
+#else
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+#endif
+}
+
+void Trace::snapshot(std::vector<Event>& events)
+{
+    for (Ring* r = g_rings; r != NULL; r = r->next)
+    {
+        barrier();
+        const uint64_t head = r->head;
+        barrier();
+        const uint64_t first = head > RING_SIZE ? head - RING_SIZE : 0;
+        const size_t from = events.size();
+        for (uint64_t i = first; i < head; ++i)
+            events.push_back(r->events[i % RING_SIZE]);
+        barrier();
+
+        // drop the spans the thread overwrote while they were copied
+        const uint64_t end = r->head;
+        if (end >= first + RING_SIZE)
+        {
+            const size_t stale = (size_t)std::min<uint64_t>(end - RING_SIZE + 1 - first, head - first);
+            events.erase(events.begin() + from, events.begin() + from + stale);
+        }
+    }
+    std::stable_sort(events.begin(), events.end(), by_start);
+}
+
+void Trace::write_json(std::ostream& os)
+{
+    std::vector<Event> events;
+    snapshot(events);
+
+    os << "{\"traceEvents\":[";
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        const Event& e = events[i];
+        if (i > 0)
+            os << ",";
+        os << "\n{\"name\":";
+        write_json_str(os, e.name);
+        os << ",\"cat\":\"haystack\",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread
+            << ",\"ts\":" << e.start << ",\"dur\":" << e.duration << ",\"args\":{";
+        bool first = true;
+        if (e.detail[0] != '\0')
+        {
+            os << "\"detail\":";
+            write_json_str(os, e.detail);
+            first = false;
+        }
+        for (size_t a = 0; a < e.num_args; ++a)
+        {
+            if (!first)
+                os << ",";
+            write_json_str(os, e.arg_names[a]);
+            os << ":" << e.arg_values[a];
+            first = false;
+        }
+        os << "}}";
+    }
+    os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+////////////////////////////////////////////////
+// Trace::Span
+////////////////////////////////////////////////
+
+Trace::Span::Span(const char* name)
+{
+    Ring& r = ring();
+    m_event.name = name;
+    m_event.detail[0] = '\0';
+    m_event.thread = r.thread;
+    m_event.num_args = 0;
+    m_hops = r.hops;
+    m_event.start = now();
+}
+
+Trace::Span::~Span()
+{
+    m_event.duration = now() - m_event.start;
+
+    Ring& r = ring();
+    if (r.hops != m_hops)
+        arg("refHops", (int64_t)(r.hops - m_hops));
+
+    const uint64_t head = r.head;
+    r.events[head % RING_SIZE] = m_event;
+    barrier();
+    r.head = head + 1;
+}
+
+void Trace::Span::detail(const std::string& detail)
+{
+    const size_t n = std::min(detail.size(), (size_t)MAX_DETAIL - 1);
+    memcpy(m_event.detail, detail.data(), n);
+    m_event.detail[n] = '\0';
+}
+
+void Trace::Span::arg(const char* name, int64_t value)
+{
+    if (m_event.num_args == MAX_ARGS)
+        return;
+    m_event.arg_names[m_event.num_args] = name;
+    m_event.arg_values[m_event.num_args] = value;
+    ++m_event.num_args;
+}
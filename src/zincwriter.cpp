@@ -9,6 +9,7 @@
 #include "zincwriter.hpp"
 #include "marker.hpp"
 #include "grid.hpp"
+#include "trace.hpp"
 #include <sstream>
 
 ////////////////////////////////////////////////
@@ -22,6 +23,10 @@ ZincWriter::ZincWriter(std::ostream& os) : m_os(os){}
 // Write a grid
 void ZincWriter::write_grid(const Grid& grid)
 {
+    HAYSTACK_TRACE_SPAN(span, "ZincWriter::write_grid");
+    HAYSTACK_TRACE_ARG(span, "rows", grid.num_rows());
+    HAYSTACK_TRACE_ARG(span, "cols", grid.num_cols());
+
     // meta
     m_os << "ver:\"2.0\"";
     write_meta(grid.meta());
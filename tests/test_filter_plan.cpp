@@ -0,0 +1,200 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+#include "headers.hpp"
+#include "filterplan.hpp"
+#include "dict.hpp"
+#include "marker.hpp"
+#include "num.hpp"
+#include "ref.hpp"
+#include "str.hpp"
+#include <boost/ptr_container/ptr_map.hpp>
+
+#include "ext/catch/catch.hpp"
+
+using namespace haystack;
+
+namespace
+{
+    class PlanPather : public Pather
+    {
+    public:
+        PlanPather(const boost::ptr_map<std::string, Dict>& m) : m_map(m) {}
+        const Dict& find(const std::string& ref) const
+        {
+            boost::ptr_map<std::string, Dict>::const_iterator it = m_map.find(ref);
+            if (it != m_map.end())
+                return *it->second;
+            return Dict::EMPTY;
+        }
+    private:
+        const boost::ptr_map<std::string, Dict>& m_map;
+    };
+
+    // a site, two equips and four points of the first equip
+    void make_recs(boost::ptr_map<std::string, Dict>& recs, TagStats& stats)
+    {
+        std::string id = "s";
+        recs.insert(id, new Dict());
+        recs.at("s").add("id", Ref("s")).add("site").add("geoCity", "Boston");
+
+        for (int e = 0; e < 2; ++e)
+        {
+            std::string id = e == 0 ? "e0" : "e1";
+            recs.insert(id, new Dict());
+            recs.at(id).add("id", Ref(id)).add("equip").add("siteRef", Ref("s"));
+        }
+
+        for (int p = 0; p < 4; ++p)
+        {
+            std::string id = std::string("p") + (char)('0' + p);
+            recs.insert(id, new Dict());
+            recs.at(id).add("id", Ref(id)).add("point").add("siteRef", Ref("s")).add("equipRef", Ref("e0")).add("num", (double)p);
+            if (p < 2)
+                recs.at(id).add("his");
+        }
+
+        for (boost::ptr_map<std::string, Dict>::const_iterator it = recs.begin(), e = recs.end(); it != e; ++it)
+            stats.add(*it->second);
+    }
+}
+
+TEST_CASE("FilterPlan testcase", "[FilterPlan]")
+{
+    boost::ptr_map<std::string, Dict> recs;
+    TagStats stats;
+    make_recs(recs, stats);
+    PlanPather pather(recs);
+
+    SECTION("TagStats counts and estimates")
+    {
+        CHECK(stats.total() == 7);
+        CHECK(stats.count("point") == 4);
+        CHECK(stats.count("his") == 2);
+        CHECK(stats.count("nope") == 0);
+        CHECK(stats.frequency("id") == 1.0);
+        CHECK(TagStats().frequency("any") == 1.0);
+
+        CHECK(stats.selectivity(*Filter::make("point")) == Approx(4.0 / 7));
+        CHECK(stats.selectivity(*Filter::make("not point")) == Approx(3.0 / 7));
+        CHECK(stats.selectivity(*Filter::make("point and his")) == Approx(4.0 / 7 * 2.0 / 7));
+        CHECK(stats.selectivity(*Filter::make("site or equip")) == Approx(1.0 / 7 + 2.0 / 7 - 2.0 / 49));
+        CHECK(stats.selectivity(*Filter::make("id==@p1")) == Approx(1.0 / 7));
+        CHECK(stats.selectivity(*Filter::make("num > 1")) == Approx(4.0 / 7 * TagStats::RANGE_SELECTIVITY));
+
+        // paths pay for every ref they follow
+        const double marker = stats.cost(*Filter::make("point"));
+        const double path = stats.cost(*Filter::make("siteRef->geoCity==\"Boston\""));
+        CHECK(marker == 1.0);
+        CHECK(path == Approx(2 + TagStats::HOP_COST + 1));
+
+        // the second operand only runs for the records the first keeps
+        CHECK(stats.cost(*Filter::make("his and point")) == Approx(1 + 2.0 / 7));
+        CHECK(stats.cost(*Filter::make("his or point")) == Approx(1 + 5.0 / 7));
+    }
+
+    SECTION("FilterPlan nodes and counts")
+    {
+        FilterPlan plan(Filter::make("point and (his or siteRef->geoCity==\"Boston\")"), stats);
+        CHECK(plan.index_id().empty());
+        CHECK(plan.access() == "scan");
+
+        const std::vector<FilterPlan::Node>& nodes = plan.nodes();
+        REQUIRE(nodes.size() == 5);
+        CHECK(nodes[0].op == "and");
+        CHECK(nodes[0].depth == 0);
+        CHECK(nodes[0].children.size() == 2);
+        CHECK(nodes[1].op == "has");
+        CHECK(nodes[1].filter->str() == "point");
+        CHECK(nodes[2].op == "or");
+        CHECK(nodes[3].op == "has");
+        CHECK(nodes[4].op == "==");
+        CHECK(nodes[4].depth == 2);
+
+        size_t matched = 0;
+        for (boost::ptr_map<std::string, Dict>::const_iterator it = recs.begin(), e = recs.end(); it != e; ++it)
+        {
+            const bool include = plan.include(*it->second, pather);
+            CHECK(include == plan.filter().include(*it->second, pather));
+            if (include)
+                ++matched;
+        }
+
+        CHECK(matched == 4);
+        CHECK(nodes[0].evaluated == 7);
+        CHECK(nodes[0].matched == 4);
+        CHECK(nodes[1].evaluated == 7);
+        CHECK(nodes[1].matched == 4);
+        CHECK(nodes[2].evaluated == 4);
+        CHECK(nodes[3].evaluated == 4);
+        CHECK(nodes[3].matched == 2);
+        // only the points without his follow siteRef
+        CHECK(nodes[4].evaluated == 2);
+        CHECK(nodes[4].matched == 2);
+
+        Grid::auto_ptr_t g = plan.to_grid();
+        CHECK(g->num_rows() == 5);
+        CHECK(g->meta().get_str("access") == "scan");
+        CHECK(g->row(2).get_str("op") == "or");
+        CHECK(g->row(4).get_double("evaluated") == 2);
+    }
+
+    SECTION("FilterPlan optimize")
+    {
+        // markers before paths, whatever the written order
+        CHECK(FilterPlan::optimize(Filter::make("siteRef->geoCity==\"Boston\" and his"), stats)->str()
+            == "his and siteRef->geoCity==\"Boston\"");
+
+        // nested operands flattened and duplicates dropped
+        CHECK(FilterPlan::optimize(Filter::make("(point and his) and (point and equipRef)"), stats)->str()
+            == "his and (point and equipRef)");
+        CHECK(FilterPlan::optimize(Filter::make("his or (his or site)"), stats)->str() == "his or site");
+        CHECK(FilterPlan::optimize(Filter::make("point and point"), stats)->str() == "point");
+
+        // or runs the operand most likely to match first
+        CHECK(FilterPlan::optimize(Filter::make("site or point"), stats)->str() == "point or site");
+
+        // operands of another kind are optimized on their own
+        CHECK(FilterPlan::optimize(Filter::make("(equip or site) and (his and point)"), stats)->str()
+            == "his and (point and (equip or site))");
+
+        // leaves are returned as is
+        Filter::shared_ptr_t leaf = Filter::make("point");
+        CHECK(FilterPlan::optimize(leaf, stats) == leaf);
+
+        // the same records match
+        const char* filters[] = {
+            "siteRef->geoCity==\"Boston\" and his",
+            "(equip or site) and (his and point)",
+            "not his and point and num >= 1",
+            "equipRef->siteRef->geoCity==\"Boston\" or site or (his and num < 1)" };
+        for (size_t i = 0; i < sizeof(filters) / sizeof(filters[0]); ++i)
+        {
+            Filter::shared_ptr_t f = Filter::make(filters[i]);
+            Filter::shared_ptr_t o = FilterPlan::optimize(f, stats);
+            for (boost::ptr_map<std::string, Dict>::const_iterator it = recs.begin(), e = recs.end(); it != e; ++it)
+                CHECK(f->include(*it->second, pather) == o->include(*it->second, pather));
+        }
+
+        FilterPlan plan(Filter::make("siteRef->geoCity==\"Boston\" and his"), stats);
+        Grid::auto_ptr_t g = plan.to_grid();
+        CHECK(g->meta().get_str("filter") == "siteRef->geoCity==\"Boston\" and his");
+        CHECK(g->meta().get_str("optimized") == "his and siteRef->geoCity==\"Boston\"");
+        CHECK(plan.nodes()[1].filter->str() == "his");
+    }
+
+    SECTION("FilterPlan id index")
+    {
+        CHECK(FilterPlan::index_id(*Filter::make("id==@p1")) == "p1");
+        CHECK(FilterPlan::index_id(*Filter::make("point and id==@p2")) == "p2");
+        CHECK(FilterPlan::index_id(*Filter::make("id==@p1 or point")).empty());
+        CHECK(FilterPlan::index_id(*Filter::make("id!=@p1")).empty());
+        CHECK(FilterPlan::index_id(*Filter::make("equipRef==@e0")).empty());
+
+        FilterPlan plan(Filter::make("point and id==@p2"), stats);
+        CHECK(plan.access() == "id index");
+    }
+}
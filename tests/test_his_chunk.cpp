@@ -0,0 +1,296 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+#include "headers.hpp"
+#include "hischunk.hpp"
+#include "hisrollup.hpp"
+#include "hisitem.hpp"
+#include "datetime.hpp"
+#include "bool.hpp"
+#include "num.hpp"
+#include <ctime>
+#include <iostream>
+
+#include "ext/catch/catch.hpp"
+
+using namespace haystack;
+
+///////////////////////////////////////////////////////////
+// HisChunk
+///////////////////////////////////////////////////////////
+
+static const int64_t T0 = 1307377620000LL;
+static const int64_t MIN = 60 * 1000LL;
+
+TEST_CASE("HisChunk testcase", "[HisChunk]")
+{
+    SECTION("HisChunk Number roundtrip")
+    {
+        HisChunk c(HisChunk::NUM_KIND, -4 * 3600);
+        const double vals[] = { 72.5, 72.5, 72.75, -1.0, 0.0, 1e300, 72.5, 3.14159265358979 };
+        const int64_t jitter[] = { 0, 0, 3, -2, 0, 1500, 20000, 0 };
+        const size_t n = sizeof(vals) / sizeof(double);
+
+        for (size_t i = 0; i < n; ++i)
+            CHECK(c.append(T0 + i * MIN + jitter[i], vals[i]));
+
+        CHECK(c.size() == n);
+        CHECK(c.first_ts() == T0);
+        CHECK(c.last_ts() == T0 + (n - 1) * MIN);
+
+        std::vector<int64_t> ts;
+        std::vector<double> v;
+        c.decode(ts, v);
+        REQUIRE(ts.size() == n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            CHECK(ts[i] == T0 + (int64_t)i * MIN + jitter[i]);
+            CHECK(v[i] == vals[i]);
+        }
+
+        // out of order and duplicate timestamps are refused
+        CHECK_FALSE(c.append(T0, 1.0));
+        CHECK_FALSE(c.append(c.last_ts(), 1.0));
+    }
+
+    SECTION("HisChunk Bool run-length")
+    {
+        HisChunk c(HisChunk::BOOL_KIND, 0);
+        std::vector<double> expected;
+        for (int i = 0; i < 500; ++i)
+        {
+            const double v = (i / 60) % 2 == 0 ? 1.0 : 0.0;
+            expected.push_back(v);
+            CHECK(c.append(T0 + i * MIN, v));
+        }
+
+        std::vector<int64_t> ts;
+        std::vector<double> v;
+        c.decode(ts, v);
+        CHECK(v == expected);
+        CHECK(ts.back() == T0 + 499 * MIN);
+    }
+
+    SECTION("HisChunk compression")
+    {
+        HisChunk c(HisChunk::NUM_KIND, 0);
+        for (int i = 0; i < HisChunk::MAX_SAMPLES; ++i)
+            CHECK(c.append(T0 + i * 15 * MIN, 68.0 + (i % 8) * 0.5));
+
+        CHECK(c.is_full());
+        CHECK_FALSE(c.append(T0 + HisChunk::MAX_SAMPLES * 15 * MIN, 1.0));
+
+        c.seal();
+        // raw samples take 16 bytes each
+        CHECK(c.byte_size() < HisChunk::MAX_SAMPLES * 4);
+    }
+}
+
+///////////////////////////////////////////////////////////
+// HisSeries
+///////////////////////////////////////////////////////////
+
+TEST_CASE("HisSeries testcase", "[HisSeries]")
+{
+    SECTION("HisSeries spans chunks")
+    {
+        HisSeries s(HisChunk::NUM_KIND, "kW");
+        const int n = HisChunk::MAX_SAMPLES * 3 + 10;
+        for (int i = 0; i < n; ++i)
+            s.append(T0 + i * MIN, i, 0);
+
+        CHECK(s.size() == (size_t)n);
+        CHECK(s.first_ts() == T0);
+        CHECK(s.last_ts() == T0 + (n - 1) * MIN);
+
+        // exclusive start, inclusive end
+        std::vector<int64_t> ts;
+        std::vector<double> v;
+        s.read(T0 + 1000 * MIN, T0 + 2100 * MIN, ts, v);
+        REQUIRE(ts.size() == 1100);
+        CHECK(ts.front() == T0 + 1001 * MIN);
+        CHECK(v.front() == 1001);
+        CHECK(ts.back() == T0 + 2100 * MIN);
+        CHECK(v.back() == 2100);
+    }
+
+    SECTION("HisSeries merge")
+    {
+        HisSeries s(HisChunk::NUM_KIND);
+        for (int i = 0; i < 10; ++i)
+            s.append(T0 + i * 2 * MIN, i, 0);
+
+        std::vector<HisChunk::Sample> batch;
+        batch.push_back(HisChunk::Sample(T0 + 3 * MIN, 100, 0));
+        batch.push_back(HisChunk::Sample(T0 + 1 * MIN, 101, 0));
+        batch.push_back(HisChunk::Sample(T0 + 4 * MIN, 102, 0));
+        batch.push_back(HisChunk::Sample(T0 + 40 * MIN, 103, 0));
+        s.merge(batch);
+
+        CHECK(s.size() == 13);
+
+        std::vector<int64_t> ts;
+        std::vector<double> v;
+        s.read(T0 - 1, T0 + 100 * MIN, ts, v);
+        REQUIRE(ts.size() == 13);
+        for (size_t i = 1; i < ts.size(); ++i)
+            CHECK(ts[i - 1] < ts[i]);
+
+        CHECK(ts[1] == T0 + 1 * MIN);
+        CHECK(v[1] == 101);
+        CHECK(ts[4] == T0 + 4 * MIN);
+        CHECK(v[4] == 102);
+        CHECK(ts.back() == T0 + 40 * MIN);
+        CHECK(v.back() == 103);
+    }
+
+    SECTION("HisSeries HisItems")
+    {
+        const TimeZone ny("New_York", -4);
+        HisSeries s(HisChunk::BOOL_KIND);
+        s.append(T0, 1.0, -4 * 3600);
+        s.append(T0 + MIN, 0.0, -4 * 3600);
+        s.append(T0 + 2 * MIN, 0.0, -5 * 3600);
+
+        std::vector<HisItem> items;
+        s.read(T0 - 1, T0 + 2 * MIN, ny, items);
+        REQUIRE(items.size() == 3);
+        CHECK(items[0].ts->millis() == T0);
+        CHECK(items[0].ts->to_zinc() == "2011-06-06T12:27:00-04:00 New_York");
+        CHECK(*items[0].val == Bool(true));
+        CHECK(*items[1].val == Bool(false));
+        CHECK(items[2].ts->tz_offset == -5 * 3600);
+        CHECK(items[2].ts->millis() == T0 + 2 * MIN);
+    }
+}
+
+///////////////////////////////////////////////////////////
+// Benchmark, run with: test_app [benchmark]
+///////////////////////////////////////////////////////////
+
+TEST_CASE("HisChunk decode throughput", "[.][benchmark]")
+{
+    const int points = 100;
+    const int samples = 60 * 24 * 30;
+
+    std::vector<HisSeries*> series;
+    size_t bytes = 0;
+    for (int p = 0; p < points; ++p)
+    {
+        HisSeries* s = new HisSeries(HisChunk::NUM_KIND, "\xE2\x84\x89");
+        for (int i = 0; i < samples; ++i)
+            s->append(T0 + i * MIN, 70.0 + ((i + p) % 50) * 0.25, 0);
+        bytes += s->byte_size();
+        series.push_back(s);
+    }
+
+    std::vector<int64_t> ts;
+    std::vector<double> v;
+    std::clock_t start = std::clock();
+    for (int p = 0; p < points; ++p)
+    {
+        ts.clear();
+        v.clear();
+        series[p]->read(T0 - 1, T0 + samples * MIN, ts, v);
+        CHECK(ts.size() == (size_t)samples);
+    }
+    const double secs = double(std::clock() - start) / CLOCKS_PER_SEC;
+    const double total = double(points) * samples;
+
+    std::cout << "HisChunk: " << total << " samples, "
+        << double(bytes) / total << " bytes/sample, "
+        << (secs > 0 ? total / secs / 1e6 : 0) << " M samples/sec decode\n";
+
+    for (int p = 0; p < points; ++p)
+        delete series[p];
+}
+
+///////////////////////////////////////////////////////////
+// HisRollup
+///////////////////////////////////////////////////////////
+
+TEST_CASE("HisRollup testcase", "[HisRollup]")
+{
+    // 1-minute samples over 3 hours, value is the minute index
+    std::vector<int64_t> ts;
+    std::vector<double> v;
+    const int64_t H = 60 * MIN;
+    const int64_t start = (T0 / H) * H;
+    for (int i = 0; i < 180; ++i)
+    {
+        ts.push_back(start + i * MIN);
+        v.push_back(i);
+    }
+
+    SECTION("HisRollup parse")
+    {
+        CHECK(HisRollup::parse("avg") == HisRollup::AVG);
+        CHECK(HisRollup::parse("last") == HisRollup::LAST);
+        CHECK(HisRollup::name(HisRollup::COUNT) == "count");
+        CHECK_THROWS(HisRollup::parse("median"));
+
+        CHECK(HisRollup::interval_millis(Num(15, "min")) == 15 * MIN);
+        CHECK(HisRollup::interval_millis(Num(1, "h")) == H);
+        CHECK(HisRollup::interval_millis(Num(1, "day")) == 24 * H);
+        CHECK_THROWS(HisRollup::interval_millis(Num(1, "kW")));
+        CHECK_THROWS(HisRollup::interval_millis(Num(0, "s")));
+    }
+
+    SECTION("HisRollup block")
+    {
+        HisRollup avg(HisRollup::AVG, H);
+        avg.add(ts, v);
+        avg.finish();
+        REQUIRE(avg.ts().size() == 3);
+        CHECK(avg.ts()[0] == start);
+        CHECK(avg.ts()[2] == start + 2 * H);
+        CHECK(avg.vals()[0] == 29.5);
+        CHECK(avg.vals()[1] == 89.5);
+
+        HisRollup mx(HisRollup::MAX, H);
+        mx.add(ts, v);
+        mx.finish();
+        CHECK(mx.vals()[1] == 119);
+
+        HisRollup cnt(HisRollup::COUNT, 20 * MIN);
+        cnt.add(ts, v);
+        cnt.finish();
+        REQUIRE(cnt.vals().size() == 9);
+        CHECK(cnt.vals()[0] == 20);
+    }
+
+    SECTION("HisRollup streaming")
+    {
+        // adding one sample at a time gives the same buckets
+        HisRollup a(HisRollup::FIRST, H), b(HisRollup::LAST, H), c(HisRollup::MIN, H), d(HisRollup::SUM, H);
+        for (size_t i = 0; i < ts.size(); ++i)
+        {
+            a.add(ts[i], v[i]);
+            b.add(ts[i], v[i]);
+            c.add(ts[i], v[i]);
+            d.add(ts[i], v[i]);
+        }
+        a.finish(); b.finish(); c.finish(); d.finish();
+        CHECK(a.vals()[2] == 120);
+        CHECK(b.vals()[2] == 179);
+        CHECK(c.vals()[1] == 60);
+        CHECK(d.vals()[0] == 1770);
+    }
+
+    SECTION("HisRollup local alignment")
+    {
+        // daily buckets start at local midnight
+        HisRollup r(HisRollup::COUNT, 24 * H, -5 * 3600);
+        const int64_t midnight_utc = 946702800000LL; // 2000-01-01T00:00-05:00
+        r.add(midnight_utc - 1, 1);
+        r.add(midnight_utc, 1);
+        r.add(midnight_utc + 23 * H, 1);
+        r.finish();
+        REQUIRE(r.ts().size() == 2);
+        CHECK(r.ts()[1] == midnight_utc);
+        CHECK(r.vals()[1] == 2);
+    }
+}
@@ -0,0 +1,68 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+#include "headers.hpp"
+#include "histogram.hpp"
+
+#include "ext/catch/catch.hpp"
+
+using namespace haystack;
+
+TEST_CASE("Histogram testcase", "[Histogram]")
+{
+    SECTION("Histogram buckets")
+    {
+        CHECK(Histogram::bucket(0) == 0);
+        CHECK(Histogram::bucket(15) == 15);
+        CHECK(Histogram::bucket(16) == 16);
+        CHECK(Histogram::bucket(17) == 16);
+        CHECK(Histogram::bucket(18) == 17);
+        CHECK(Histogram::bucket(~(uint64_t)0) == Histogram::BUCKETS - 1);
+
+        // buckets are contiguous and at most 12.5% wide
+        for (size_t i = Histogram::LINEAR; i < Histogram::BUCKETS - 1; ++i)
+        {
+            CHECK(Histogram::lower_bound(i + 1) == Histogram::upper_bound(i) + 1);
+            CHECK(Histogram::bucket(Histogram::lower_bound(i)) == i);
+            CHECK(Histogram::bucket(Histogram::upper_bound(i)) == i);
+            const uint64_t width = Histogram::upper_bound(i) - Histogram::lower_bound(i) + 1;
+            const uint64_t widths = width * 8;
+            CHECK(widths <= Histogram::lower_bound(i));
+        }
+        CHECK(Histogram::upper_bound(Histogram::BUCKETS - 1) == ~(uint64_t)0);
+    }
+
+    SECTION("Histogram percentiles")
+    {
+        Histogram h;
+        CHECK(h.count() == 0);
+        CHECK(h.percentile(0.5) == 0);
+
+        for (uint64_t v = 1; v <= 1000; ++v)
+            h.record(v);
+
+        CHECK(h.count() == 1000);
+        CHECK(h.sum() == 500500);
+        CHECK(h.max() == 1000);
+        CHECK(h.percentile(1.0) == 1000);
+
+        const uint64_t p50 = h.percentile(0.5);
+        CHECK(p50 >= 500);
+        CHECK(p50 <= 500 + 500 / 8);
+
+        const uint64_t p99 = h.percentile(0.99);
+        CHECK(p99 >= 990);
+        CHECK(p99 <= 1000);
+    }
+
+    SECTION("Counter")
+    {
+        Counter c;
+        c.add();
+        c.add(41);
+        CHECK(c.value() == 42);
+    }
+}
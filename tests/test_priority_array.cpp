@@ -0,0 +1,127 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+#include "headers.hpp"
+#include "priorityarray.hpp"
+#include "grid.hpp"
+#include "num.hpp"
+#include "str.hpp"
+
+#include "ext/catch/catch.hpp"
+
+using namespace haystack;
+
+TEST_CASE("PriorityArray testcase", "[PriorityArray]")
+{
+    PriorityArray pa("AHU-ZoneSP");
+
+    SECTION("PriorityArray arbitration")
+    {
+        CHECK(pa.level() == 0);
+        CHECK(pa.val() == NULL);
+
+        CHECK(pa.write(17, Num(70), "default"));
+        CHECK(pa.level() == 17);
+
+        CHECK(pa.write(8, Num(72), "op"));
+        CHECK(pa.level() == 8);
+        CHECK(*pa.val() == Num(72));
+
+        // lower priority write does not change the effective value
+        CHECK_FALSE(pa.write(10, Num(65), "sched"));
+        CHECK(*pa.val() == Num(72));
+
+        // same value at the effective level is not a change
+        CHECK_FALSE(pa.write(8, Num(72), "op"));
+        CHECK(pa.write(8, Num(73), "op"));
+
+        // a higher priority write of the effective value is not a change
+        CHECK_FALSE(pa.write(5, Num(73), "safety"));
+        CHECK(pa.level() == 5);
+        CHECK_FALSE(pa.release(5));
+        CHECK(pa.level() == 8);
+
+        CHECK(pa.release(8));
+        CHECK(pa.level() == 10);
+        CHECK(*pa.val() == Num(65));
+        CHECK(pa.who(10) == "sched");
+        CHECK(pa.val(8) == NULL);
+
+        // releasing an unset or lower level is not a change
+        CHECK_FALSE(pa.release(8));
+        CHECK_FALSE(pa.write(17, EmptyVal::DEF, "x"));
+        CHECK(pa.level() == 10);
+
+        CHECK_THROWS(pa.write(0, Num(1), "x"));
+        CHECK_THROWS(pa.write(18, Num(1), "x"));
+    }
+
+    SECTION("PriorityArray grid")
+    {
+        pa.write(16, Str("on"), "who");
+
+        boost::shared_ptr<const Grid> g = pa.grid();
+        REQUIRE(g->num_rows() == 17);
+        CHECK(g->row(15).get("val") == Str("on"));
+        CHECK(g->row(15).get_str("who") == "who");
+        CHECK(g->row(0).missing("val"));
+        CHECK(g->row(16).get_str("levelDis") == "Default");
+
+        // shared until the next change
+        CHECK(pa.grid() == g);
+        pa.write(1, Str("off"), "who");
+        CHECK(pa.grid() != g);
+        CHECK(g->row(0).missing("val"));
+    }
+
+    SECTION("PriorityArray slot expiry")
+    {
+        TimerWheel w;
+        pa.write(8, Num(1), "op");
+        pa.write(17, Num(0), "default");
+        w.schedule(pa.slot(8), 2);
+
+        std::vector<TimerWheel::Entry*> expired;
+        w.tick(expired);
+        w.tick(expired);
+        REQUIRE(expired.size() == 1);
+
+        PriorityArray::Slot& s = static_cast<PriorityArray::Slot&>(*expired[0]);
+        CHECK(&s.array() == &pa);
+        CHECK(s.array().id() == "AHU-ZoneSP");
+        CHECK(s.level() == 8);
+        CHECK(s.array().release(s.level()));
+        CHECK(*pa.val() == Num(0));
+    }
+
+    SECTION("PriorityArray timed write")
+    {
+        CHECK(PriorityArray::duration_millis(Num(30, "s")) == 30000);
+        CHECK(PriorityArray::duration_millis(Num(2, "min")) == 120000);
+        CHECK(PriorityArray::duration_millis(Num(1, "wk")) == 604800000);
+
+        const Num secs(30, "s");
+        const Num unitless(5);
+        const Num kg(5, "kg");
+        CHECK(pa.write(8, Num(72, "°F"), "op", &secs));
+        CHECK(pa.slot(8).duration() == 30000);
+        boost::shared_ptr<const Grid> g = pa.grid();
+
+        // a bad duration leaves the array as it was
+        CHECK_THROWS(pa.write(8, Num(75, "°F"), "other", &unitless));
+        CHECK_THROWS(pa.write(1, Num(75, "°F"), "other", &kg));
+        CHECK(pa.level() == 8);
+        CHECK(*pa.val() == Num(72, "°F"));
+        CHECK(pa.who(8) == "op");
+        CHECK(pa.val(1) == NULL);
+        CHECK(pa.slot(8).duration() == 30000);
+        CHECK(pa.grid() == g);
+
+        // a permanent write clears the duration
+        pa.write(8, Num(72, "°F"), "op", NULL);
+        CHECK(pa.slot(8).duration() == 0);
+    }
+}
@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+#include "headers.hpp"
+#include "timerwheel.hpp"
+
+#include "ext/catch/catch.hpp"
+
+using namespace haystack;
+
+namespace
+{
+    struct Lease : public TimerWheel::Entry
+    {
+        Lease(int id) : id(id) {}
+        int id;
+    };
+
+    // tick until the wheel reaches the given tick, return expired ids
+    std::vector<int> run_to(TimerWheel& w, uint64_t tick)
+    {
+        std::vector<int> ids;
+        std::vector<TimerWheel::Entry*> expired;
+        while (w.now() < tick)
+        {
+            expired.clear();
+            w.tick(expired);
+            for (size_t i = 0; i < expired.size(); ++i)
+                ids.push_back(static_cast<Lease*>(expired[i])->id);
+        }
+        return ids;
+    }
+}
+
+TEST_CASE("TimerWheel testcase", "[TimerWheel]")
+{
+    TimerWheel w(8);
+    Lease a(1), b(2), c(3);
+
+    SECTION("TimerWheel expire")
+    {
+        w.schedule(a, 3);
+        w.schedule(b, 5);
+        CHECK(w.size() == 2);
+        CHECK(a.is_scheduled());
+
+        CHECK(run_to(w, 2).empty());
+        std::vector<int> ids = run_to(w, 3);
+        REQUIRE(ids.size() == 1);
+        CHECK(ids[0] == 1);
+        CHECK_FALSE(a.is_scheduled());
+        CHECK(w.size() == 1);
+
+        CHECK(run_to(w, 5) == std::vector<int>(1, 2));
+        CHECK(w.size() == 0);
+    }
+
+    SECTION("TimerWheel renew and cancel")
+    {
+        w.schedule(a, 3);
+        w.schedule(b, 3);
+        run_to(w, 2);
+
+        // renew pushes the deadline out
+        w.schedule(a, 3);
+        w.cancel(b);
+        CHECK(run_to(w, 4).empty());
+        CHECK(run_to(w, 5) == std::vector<int>(1, 1));
+    }
+
+    SECTION("TimerWheel more than a turn")
+    {
+        // 8 slots, deadline 2.5 turns away shares the slot of earlier ticks
+        w.schedule(a, 20);
+        w.schedule(c, 4);
+        CHECK(run_to(w, 4) == std::vector<int>(1, 3));
+        CHECK(run_to(w, 19).empty());
+        CHECK(run_to(w, 20) == std::vector<int>(1, 1));
+    }
+
+    SECTION("TimerWheel entry destroyed while scheduled")
+    {
+        {
+            Lease d(4);
+            w.schedule(d, 2);
+            w.schedule(a, 2);
+        }
+        CHECK(w.size() == 1);
+        CHECK(run_to(w, 2) == std::vector<int>(1, 1));
+    }
+}
@@ -0,0 +1,117 @@
+//
+// Copyright (c) 2015, J2 Innovations
+// Licensed under the Academic Free License version 3.0
+// History:
+//   19 Oct 2026  Creation
+//
+#include "headers.hpp"
+#include "trace.hpp"
+#include <sstream>
+#include <string.h>
+
+#include "ext/catch/catch.hpp"
+
+using namespace haystack;
+
+namespace
+{
+    // spans of the given name, oldest first
+    std::vector<Trace::Event> spans(const char* name)
+    {
+        std::vector<Trace::Event> all;
+        Trace::snapshot(all);
+
+        std::vector<Trace::Event> found;
+        for (size_t i = 0; i < all.size(); ++i)
+            if (strcmp(all[i].name, name) == 0)
+                found.push_back(all[i]);
+        return found;
+    }
+}
+
+TEST_CASE("Trace testcase", "[Trace]")
+{
+    SECTION("Trace span")
+    {
+        {
+            Trace::Span outer("test.outer");
+            outer.detail("site and equip");
+            outer.arg("scanned", 10);
+            {
+                Trace::Span inner("test.inner");
+                Trace::add_hop();
+                Trace::add_hop();
+            }
+            Trace::add_hop();
+        }
+
+        std::vector<Trace::Event> outer = spans("test.outer");
+        std::vector<Trace::Event> inner = spans("test.inner");
+        REQUIRE(outer.size() == 1);
+        REQUIRE(inner.size() == 1);
+
+        CHECK(std::string(outer[0].detail) == "site and equip");
+        REQUIRE(outer[0].num_args == 2);
+        CHECK(std::string(outer[0].arg_names[0]) == "scanned");
+        CHECK(outer[0].arg_values[0] == 10);
+        CHECK(std::string(outer[0].arg_names[1]) == "refHops");
+        CHECK(outer[0].arg_values[1] == 3);
+
+        REQUIRE(inner[0].num_args == 1);
+        CHECK(inner[0].arg_values[0] == 2);
+        CHECK(inner[0].thread == outer[0].thread);
+        CHECK(inner[0].start >= outer[0].start);
+        const uint64_t inner_end = inner[0].start + inner[0].duration;
+        const uint64_t outer_end = outer[0].start + outer[0].duration;
+        CHECK(inner_end <= outer_end);
+    }
+
+    SECTION("Trace detail and args are bounded")
+    {
+        {
+            Trace::Span s("test.bounded");
+            s.detail(std::string(200, 'x'));
+            for (int i = 0; i < 5; ++i)
+                s.arg("n", i);
+        }
+
+        std::vector<Trace::Event> found = spans("test.bounded");
+        REQUIRE(found.size() == 1);
+        CHECK(strlen(found[0].detail) == Trace::MAX_DETAIL - 1);
+        CHECK(found[0].num_args == (size_t)Trace::MAX_ARGS);
+        CHECK(found[0].arg_values[Trace::MAX_ARGS - 1] == Trace::MAX_ARGS - 1);
+    }
+
+    SECTION("Trace ring keeps the newest spans")
+    {
+        for (int i = 0; i < Trace::RING_SIZE + 100; ++i)
+        {
+            Trace::Span s("test.ring");
+            s.arg("i", i);
+        }
+
+        std::vector<Trace::Event> found = spans("test.ring");
+        REQUIRE(found.size() <= (size_t)Trace::RING_SIZE);
+        REQUIRE(!found.empty());
+        CHECK(found.back().arg_values[0] == Trace::RING_SIZE + 99);
+        for (size_t i = 1; i < found.size(); ++i)
+            CHECK(found[i].arg_values[0] == found[i - 1].arg_values[0] + 1);
+    }
+
+    SECTION("Trace Chrome JSON")
+    {
+        {
+            Trace::Span s("test.json");
+            s.detail("say \"hi\"\n");
+            s.arg("rows", 42);
+        }
+
+        std::ostringstream os;
+        Trace::write_json(os);
+        const std::string json = os.str();
+
+        CHECK(json.find("{\"traceEvents\":[") == 0);
+        CHECK(json.find("\"name\":\"test.json\",\"cat\":\"haystack\",\"ph\":\"X\"") != json.npos);
+        CHECK(json.find("\"args\":{\"detail\":\"say \\\"hi\\\"\\u000a\",\"rows\":42}") != json.npos);
+    }
+}
@@ -434,6 +434,14 @@ TEST_CASE("Num testcase", "[Num]")
     CHECK_THROWS(Num(123.4, "foo bar"));
     CHECK_THROWS(Num(123.4, "foo,bar"));
 
+    // durations
+    CHECK(Num(250, "ms").millis() == 250);
+    CHECK(Num(1.5, "sec").millis() == 1500);
+    CHECK(Num(2, "hr").millis() == 2 * 60 * 60 * 1000);
+    CHECK(Num(1, "wk").millis() == 7 * 24 * 60 * 60 * 1000);
+    CHECK_THROWS(Num(5).millis());
+    CHECK_THROWS(Num(5, "kg").millis());
+
     //std::cout << n.to_zinc() << "\n";
 }
 